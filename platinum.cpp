@@ -5,15 +5,34 @@
  * - Include
  * - Headers
  * - Constants
+ * - Opening book
+ * - Counters
  * - Global var
  * - Classes
+ *   - Telemetry
  *   - Zone
  *   - ZoneIntend
+ *   - TranspositionCache
  *   - Mood
+ *   - Cluster
  *   - Continent
  *   - Pod
  *   - Overlord
  *   - Overmind
+ * - Board
+ *   - Topology
+ *   - Snapshot and transitions
+ *   - Batch of boards resolved with vector lanes
+ * - Hashing
+ *   - Zobrist keys of zones neighbourhood
+ * - Influence
+ *   - Decayed enemy threat and per player strength over a few hops
+ * - Mobility
+ *   - Per opponent departure rates, weighting the threat each zone spreads
+ * - Frontier
+ *   - Distance to the zones we do not own, repaired on ownership changes
+ * - Landmarks
+ *   - Point to point A* with landmark distances (ALT)
  * - PathFinding
  *   - Path finding with closure and weight
  * - Commands
@@ -21,14 +40,47 @@
  *   - AddMove
  *   - Create
  *   - AddCreate
+ * - Workers
+ *   - Persistent pinned pool with per worker deques, calibrated inline threshold
+ * - Planner
+ *   - Rollout planner for contested zones
+ * - Cooperative planning (C++20 builds)
+ *   - Pod planning coroutines and their scheduler
+ * - Pondering
+ *   - DistanceTable
+ *   - Ponderer
+ * - Assignment
+ *   - FlowSolver
+ *   - Pods to targets assignment
+ * - Map file
+ *   - Precompiled map, mapped in memory and used in place
+ * - Replay
+ *   - Recorder, indexed store of recorded turns and batch analytics
  * - Initialisation
+ *   - Continents, union-find and contiguous renumbering or map file ranges
+ *   - Clusters
+ *   - Topology
+ *   - Footprint
+ *   - Game
  * - Update
  *   - UpdateCommands
  *   - UpdatePlatinum
  *   - UpdateZones
+ *   - MatchPods
  *   - UpdateOvermind
+ *   - EstimateTurnWork
+ *   - UpdatePlanner
+ *   - UpdateAssignment
  *   - UpdatePods
+ *   - UpdateTelemetry
+ *   - UpdateRecord
+ *   - PlayTurn
+ *   - Counters
  * - Clear
+ * - Server
+ *   - Several games in one process, multiplexed frames (PLATINUM_SERVER)
+ * - Differential (PLATINUM_DIFFERENTIAL builds)
+ *   - Reference against optimised decisions, on recorded and synthetic turns
  * - Main()
  * 
  * */
@@ -39,7 +91,34 @@
 #include <sstream>
 #include <vector>
 #include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <cstdio>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
+#ifdef __cpp_impl_coroutine
+#include <coroutine>
+#endif
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+#include <pthread.h>
+#ifdef PLATINUM_DIFFERENTIAL
+#include <map>
+#include <sys/wait.h>
+#include <signal.h>
+#include <poll.h>
+#endif
 
 using namespace std;
 
@@ -47,34 +126,129 @@ using namespace std;
 /** HEADERS **/
 struct Global;
 
+struct Counters;
+struct ZoneLinks;
+class Telemetry;
 class Zone;
 class ZoneIntend;
+class TranspositionCache;
 class Mood;
+class Cluster;
 class Continent;
+struct ZoneRange;
 class Overlord;
 class Overmind;
 class Continent;
 class Pod;
 
+struct IntView;
+struct BoardTopology;
+struct Board;
+struct BatchBoard;
+struct InfluenceSource;
+class InfluenceMap;
+struct MobilityRing;
+class MobilityModel;
+int departureRate(int zone);
+int departureRate(int zone, int slot);
+class FrontierField;
+int frontierDistance(Zone* z);
+class LandmarkRouter;
+int routeTo(Zone* from, Zone* to, vector<Zone*>& path);
+
 struct Move;
 void addMove(int podsCount, Zone* zoneOrigin, Zone* zoneDestination);
 struct Create;
 void addCreate(int podsCount, Zone* zoneDestination);
 
-ZoneIntend* pathFinding(Zone* origin, function<bool (Zone*)> func);
+class WorkerPool;
+
+struct PlanMove;
+struct Plan;
+struct Random;
+void planContestedZones();
+
+#ifdef __cpp_impl_coroutine
+struct PlanTask;
+PlanTask planPod(Pod* p);
+class PlanScheduler;
+#endif
+
+class DistanceTable;
+class Ponderer;
+void startPondering();
+void stopPondering();
+
+struct FlowEdge;
+class FlowSolver;
+struct Assignment;
+class Assigner;
+
+struct MapHeader;
+class MapFile;
+
+struct ReplayTurn;
+struct ReplayHeader;
+struct ReplayGame;
+class Recorder;
+class ReplayStore;
+struct ReplayStats;
+bool runAnalytics(const char* path);
+struct OpeningMove;
+bool generateOpening(int rollouts);
+
+ZoneIntend* pathFinding(Zone* origin, function<bool (Zone*)> func, Mood* mood, int maxDistance);
+
+enum ZobristField {
+    ZOBRIST_OWNER,
+    ZOBRIST_MY_PODS,
+    ZOBRIST_P1,
+    ZOBRIST_P2,
+    ZOBRIST_P3,
+    ZOBRIST_DANGER,
+    ZOBRIST_INTEND,
+    ZOBRIST_ORIGIN              // identifies the zone a neighbourhood hash is looked up from
+};
+
+unsigned long long mix64(unsigned long long x);
+unsigned long long hashText(unsigned long long hash, const string& text);
+unsigned long long zobristKey(int zoneId, int field, int value);
+void refreshZoneKey(Zone* z);
 
 void initOvermind();
-void rec_continent(Continent* c, Zone* z);
+void parseLink(const string& line, vector<int>& ends);
+int findRoot(vector<int>& parent, int z);
 void initContinents();
+void mergeContinents();
+void loadContinents();
+void initClusters();
+void initTopology();
+void reportFootprint();
+void initGame(int game = -1);
 
 void updateCommands();
 void updatePlatinum();
 void updateZones();
+void matchPods();
 void updateOverlords();
+int estimateTurnWork();
+void updatePlanner();
+void updateAssignment();
 void updatePods();
+void logPod(Pod* p);
+void updateTelemetry();
+void updateRecord();
+void playTurn();
+const Counters& getTurnCounters();
+const Counters& getGameCounters();
+void reportCounters();
 
 void clear();
 
+struct World;
+struct GameFrame;
+class GameServer;
+
 
 /** CONTANTS **/
 const int DEFAULT_RATIO = 10;
@@ -83,17 +257,430 @@ const int MIN_WEIGHT_RATIO = -10000;
 const int WEALTH_CONCENTRATION_FACTOR = 50;
 const int POD_PRICE = 20;
 const int MAX_NEIGHBOURS = 6;
+const int MAX_PLAYERS = 4;
+const int MAX_BOARD_ZONES = 256;       // official maps have 154 zones
+const int MAX_BOARD_DISTANCE = 1 << 20; // longer than any path
+const int MAX_FIGHT_ROUNDS = 3;
+//Boards resolved side by side by a BatchBoard, one native vector of ints :
+//wider vectors are split by the compiler and lose to the scalar Board
+#ifdef __AVX2__
+const int BATCH_LANES = 8;
+#else
+const int BATCH_LANES = 4;
+#endif
+const int PLANNER_TIME_BUDGET_MS = 15;  // rollout time allowed per turn
+const int PODS_TIME_BUDGET_MS = 40;     // pods planning allowed per turn
+const int PLANNER_THREADS = 0;          // 0 : one thread per core
+const int PLANNER_DEPTH = 3;            // simulated turns per rollout
+const int PLANNER_RADIUS = 2;           // hops around a contested zone taken into account
+const int PLANNER_MAX_ZONES = 8;        // contested zones planned per turn
+const int PLANNER_MAX_REINFORCE = 6;    // pods pulled in by a reinforcement plan
+const int PLANNER_RANDOM_PLANS = 4;     // sampled reinforcement plans per zone
+const int PLANNER_ZONE_SCORE = 2;
+const int PLANNER_PLATINUM_SCORE = 3;
+const int PLANNER_POD_SCORE = 2;
+const int MAX_MOODS = 8;
+const bool POD_PLAN_REUSE = true;      // pods follow last turn's path while it stays valid
+const int CLUSTER_SIZE = 8;             // zones grouped in a cluster
+const int ASSIGNMENT_MAX_DISTANCE = 8;  // farther targets are left to the moods
+const int FLOW_INFINITY = 1 << 29;
+const int INFLUENCE_HOPS = 3;           // 1 gives back the direct neighbours danger
+const float INFLUENCE_DECAY = 0.5f;     // strength kept per hop
+const bool MOBILITY_MODEL = true;       // threat spread by a zone is weighted by the learnt enemy mobility
+const int MOBILITY_HISTORY = 8;         // departure rates kept per zone and per opponent
+const int MOBILITY_PRIOR_WEIGHT = 2;    // weight of the opponent wide rate on a zone rate
+const int PONDER_PREDICTIONS = 2;       // enemies holding, enemies moving as the mobility model expects
+const int FRONTIER_UNREACHABLE = 1 << 29;   // frontier distance on a continent we fully own
+const int ALT_LANDMARKS = 4;            // landmarks of each continent
+const int TELEMETRY_MAX_PHASES = 16;
+const char MAP_FILE_MAGIC[8] = {'P', 'L', 'A', 'T', 'M', 'A', 'P', '2'};
+const char REPLAY_FILE_MAGIC[8] = {'P', 'L', 'A', 'T', 'R', 'E', 'P', '2'};
+const int REPLAY_LATENCY_BUCKET_US = 100;   // width of a decision latency bucket
+const int REPLAY_LATENCY_BUCKETS = 10000;   // the last one gathers the slower turns
+const int PURCHASE_MAX_INTEND = 3;      // pods bought at most on a zone
+const int PURCHASE_STACK_PENALTY = 1;   // value lost by each extra pod bought on the same zone
+const int PURCHASE_LOOKAHEAD_PERCENT = 50;  // worth of a purchase delayed to the next turn
+const int OPENING_BOOK_DEPTH = 8;       // turns simulated after an opening by the generator
+const int OPENING_BOOK_SAMPLES = 16;    // random openings tried by the generator, besides the fixed ones
+const int DIFFERENTIAL_SYNTHETIC = 4;   // mutated copies checked with each turn
+const int DIFFERENTIAL_MUTATIONS = 6;   // pods counts changed in a mutated copy
+const int DIFFERENTIAL_BASELINE_TIMEOUT_MS = 5000;  // the frozen bot may search exponentially long
+
+
+/** OPENING BOOK **/
+/*
+  Purchases of the first turn, keyed by the map fingerprint
+  (topology, platinum layout, player count and our id, see Overmind::computeMapFingerprint).
+  Entries are generated offline by the simulator : PLATINUM_OPENING_BOOK=<rollouts> reads
+  the map and first turn of a game on stdin, plays candidate openings against random
+  opponents on board snapshots and prints the lines of the best one, to paste before the sentinel.
+  Only the first turn is kept : the next ones depend on the openings of the opponents.
+  Maps missing from the book go through purchasePods with the first turn rules.
+*/
+struct OpeningMove {
+    unsigned long long fingerprint;
+    int zone;                           // referee id
+    int count;
+};
+
+constexpr OpeningMove OPENING_BOOK[] = {
+    //12x10 grid, 2 players, generated layout 0
+    {0x70122b49c6bef403ULL, 8, 1},
+    {0x70122b49c6bef403ULL, 10, 1},
+    {0x70122b49c6bef403ULL, 13, 1},
+    {0x70122b49c6bef403ULL, 25, 1},
+    {0x70122b49c6bef403ULL, 32, 1},
+    {0x70122b49c6bef403ULL, 43, 1},
+    {0x70122b49c6bef403ULL, 44, 1},
+    {0x70122b49c6bef403ULL, 58, 1},
+    {0x70122b49c6bef403ULL, 70, 1},
+    {0x70122b49c6bef403ULL, 73, 1},
+    //12x10 grid, 2 players, generated layout 1
+    {0xa49450daad69cccdULL, 1, 1},
+    {0xa49450daad69cccdULL, 3, 1},
+    {0xa49450daad69cccdULL, 4, 1},
+    {0xa49450daad69cccdULL, 8, 1},
+    {0xa49450daad69cccdULL, 12, 1},
+    {0xa49450daad69cccdULL, 17, 1},
+    {0xa49450daad69cccdULL, 25, 1},
+    {0xa49450daad69cccdULL, 39, 1},
+    {0xa49450daad69cccdULL, 48, 1},
+    {0xa49450daad69cccdULL, 68, 1},
+    //12x10 grid, 2 players, generated layout 2
+    {0x146ee9b2b58e0b14ULL, 13, 1},
+    {0x146ee9b2b58e0b14ULL, 16, 1},
+    {0x146ee9b2b58e0b14ULL, 31, 1},
+    {0x146ee9b2b58e0b14ULL, 36, 1},
+    {0x146ee9b2b58e0b14ULL, 40, 1},
+    {0x146ee9b2b58e0b14ULL, 41, 1},
+    {0x146ee9b2b58e0b14ULL, 45, 1},
+    {0x146ee9b2b58e0b14ULL, 66, 1},
+    {0x146ee9b2b58e0b14ULL, 83, 1},
+    {0x146ee9b2b58e0b14ULL, 88, 1},
+    //12x10 grid, 2 players, generated layout 3
+    {0x671ce9425ad3e97aULL, 4, 1},
+    {0x671ce9425ad3e97aULL, 5, 1},
+    {0x671ce9425ad3e97aULL, 11, 1},
+    {0x671ce9425ad3e97aULL, 19, 1},
+    {0x671ce9425ad3e97aULL, 26, 1},
+    {0x671ce9425ad3e97aULL, 31, 1},
+    {0x671ce9425ad3e97aULL, 34, 1},
+    {0x671ce9425ad3e97aULL, 35, 1},
+    {0x671ce9425ad3e97aULL, 36, 1},
+    {0x671ce9425ad3e97aULL, 37, 1},
+    //12x10 grid, 2 players, generated layout 4
+    {0x8a517117c96664deULL, 3, 1},
+    {0x8a517117c96664deULL, 18, 1},
+    {0x8a517117c96664deULL, 21, 1},
+    {0x8a517117c96664deULL, 25, 1},
+    {0x8a517117c96664deULL, 28, 1},
+    {0x8a517117c96664deULL, 31, 1},
+    {0x8a517117c96664deULL, 52, 1},
+    {0x8a517117c96664deULL, 59, 1},
+    {0x8a517117c96664deULL, 69, 1},
+    {0x8a517117c96664deULL, 72, 1},
+    //12x10 grid, 2 players, generated layout 5
+    {0x198ab73cbb429e68ULL, 9, 1},
+    {0x198ab73cbb429e68ULL, 12, 1},
+    {0x198ab73cbb429e68ULL, 26, 1},
+    {0x198ab73cbb429e68ULL, 28, 1},
+    {0x198ab73cbb429e68ULL, 30, 1},
+    {0x198ab73cbb429e68ULL, 40, 1},
+    {0x198ab73cbb429e68ULL, 46, 1},
+    {0x198ab73cbb429e68ULL, 55, 1},
+    {0x198ab73cbb429e68ULL, 56, 1},
+    {0x198ab73cbb429e68ULL, 57, 1},
+    //12x10 grid, 2 players, generated layout 6
+    {0xeecb92728034c0f4ULL, 9, 1},
+    {0xeecb92728034c0f4ULL, 19, 1},
+    {0xeecb92728034c0f4ULL, 27, 1},
+    {0xeecb92728034c0f4ULL, 33, 1},
+    {0xeecb92728034c0f4ULL, 45, 1},
+    {0xeecb92728034c0f4ULL, 64, 1},
+    {0xeecb92728034c0f4ULL, 65, 1},
+    {0xeecb92728034c0f4ULL, 82, 1},
+    {0xeecb92728034c0f4ULL, 85, 1},
+    {0xeecb92728034c0f4ULL, 86, 1},
+    //12x10 grid, 2 players, generated layout 7
+    {0x69b582fe9f4acb67ULL, 7, 1},
+    {0x69b582fe9f4acb67ULL, 17, 1},
+    {0x69b582fe9f4acb67ULL, 21, 1},
+    {0x69b582fe9f4acb67ULL, 23, 1},
+    {0x69b582fe9f4acb67ULL, 26, 1},
+    {0x69b582fe9f4acb67ULL, 34, 1},
+    {0x69b582fe9f4acb67ULL, 35, 1},
+    {0x69b582fe9f4acb67ULL, 41, 1},
+    {0x69b582fe9f4acb67ULL, 54, 1},
+    {0x69b582fe9f4acb67ULL, 60, 1},
+    {0, -1, 0}                          // sentinel
+};
+const int CACHE_SIZE = 1 << 14;         // entries per transposition table, power of two
+const unsigned long long ZOBRIST_SEED = 0x2545F4914F6CDD1DULL;
+const int CACHE_LINE_SIZE = 64;
+
+
+/** COUNTERS **/
+/*
+  Work done by each subsystem, always counted.
+  The turn counters are cleared when a turn starts and added to the game counters when it ends.
+  Aligned on a cache line, so increments do not share it with other data.
+*/
+struct alignas(CACHE_LINE_SIZE) Counters {
+    long long bfsCalls;                     // path findings run
+    long long bfsExpanded;                  // zones whose neighbours were explored
+    long long podsEvaluated;                // pods which evaluated their moods
+    long long catcherCalls[MAX_MOODS];      // catcher evaluations, by mood index
+    long long podAllocations;
+    long long intendAllocations;            // ZoneIntend
+    long long moveAllocations;              // growths of the moves list
+    long long createAllocations;            // growths of the creates list
+    long long purchaseCells;                // knapsack cells filled by Overmind::update
+    long long routeCalls;                   // point to point searches
+    long long routeExpanded;                // zones expanded by these searches
+    long long turnWork;                     // estimated by estimateTurnWork
+    long long pooledTurns;                  // turns whose rollouts fanned out to the worker pool
+    
+    void clear()
+    {
+        memset(this, 0, sizeof(Counters));
+    }
+    
+    void add(const Counters& c)
+    {
+        bfsCalls += c.bfsCalls;
+        bfsExpanded += c.bfsExpanded;
+        podsEvaluated += c.podsEvaluated;
+        for(int i = 0; i < MAX_MOODS; i++)
+        {
+            catcherCalls[i] += c.catcherCalls[i];
+        }
+        podAllocations += c.podAllocations;
+        intendAllocations += c.intendAllocations;
+        moveAllocations += c.moveAllocations;
+        createAllocations += c.createAllocations;
+        purchaseCells += c.purchaseCells;
+        routeCalls += c.routeCalls;
+        routeExpanded += c.routeExpanded;
+        turnWork += c.turnWork;
+        pooledTurns += c.pooledTurns;
+    }
+    
+    long long getCatcherCalls() const
+    {
+        long long total = 0;
+        for(int i = 0; i < MAX_MOODS; i++)
+        {
+            total += catcherCalls[i];
+        }
+        return total;
+    }
+};
 
 
 /** GLOBAL VAR **/
-vector<Zone*> zones;                // Zone list
-vector<Continent*> continents;      // Continent list
-vector<Move> moves;                 // List of Move command
-vector<Create> creates;             // List of Create command
-vector<Pod*> pods;                  // List of pods
-Overmind* overmind;
+// Per game state, one world per thread : see GameServer for several games in one process
+thread_local vector<Zone*> zones;           // Zone list, each continent is a contiguous slice
+thread_local vector<Zone*> zonesById;       // Zone list in the referee's order
+thread_local vector<Continent*> continents; // Continent list
+thread_local vector<Move> moves;            // List of Move command
+thread_local vector<Create> creates;        // List of Create command
+thread_local vector<Pod*> pods;             // List of pods
+thread_local Overmind* overmind;
+thread_local BoardTopology* topology;       // Static graph shared by every board snapshot
+thread_local TranspositionCache* cache;     // Memoized zone values and mood hops
+thread_local Assigner* assigner;            // Pods to targets assignment
+thread_local InfluenceMap* influence;       // Friendly and enemy strength fields
+thread_local MobilityModel* mobility;       // Learnt enemy movements
+thread_local FrontierField* frontier;       // Distances to the zones we do not own
+thread_local LandmarkRouter* router;        // Point to point routes
+thread_local DistanceTable* distances;      // All pairs distances, filled while pondering
+thread_local Ponderer* ponderer;            // Background work between two turns
+thread_local Telemetry* telemetry;          // Per turn metrics, see PLATINUM_TELEMETRY
+thread_local Recorder* recorder;            // Recorded turns, see PLATINUM_RECORD
+thread_local MapFile* mapFile;              // Precompiled map, see PLATINUM_MAP ; nullptr when read from stdin
+thread_local Counters turnCounters;         // Work of the current turn
+thread_local Counters gameCounters;         // Work since the start of the game
+thread_local istream* gameInput = &cin;     // Referee input of the game played by this thread
+thread_local ostream* gameOutput = &cout;   // Commands of the game played by this thread
+bool serverMode = false;                    // several games per process, see PLATINUM_SERVER
+WorkerPool* workerPool;                     // shared by the games of the process, nullptr in server mode
+#ifdef PLATINUM_DIFFERENTIAL
+class Differential;
+Differential* differential;         // Reference against optimised decisions
+bool exactShortcuts = true;         // off in the reference runs
+#else
+const bool exactShortcuts = true;   // caches and prunings that never change a decision
+#endif
 
 /** CLASSES **/
+/*
+  Optional per turn metrics, written as one JSON line per turn.
+  The PLATINUM_TELEMETRY environment variable selects the sink :
+  a file descriptor number above 1 (0 and 1 carry the referee's game),
+  "memory" to keep the lines in 'buffer', or else a file path lines are appended to.
+  In server mode each game writes to its own file, the path followed by ".<game>" ;
+  a descriptor would be shared by the games and is rejected.
+  When disabled, phase marks return at once and no line is built.
+*/
+class Telemetry {
+    public:
+        bool enabled;
+        int turn;
+        string buffer;                      // lines of the "memory" sink
+        
+        //'game' is the id of a server game, -1 when the process plays a single game
+        Telemetry(const char* sink, int game)
+        {
+            enabled = sink != nullptr && sink[0] != 0;
+            _fd = -1;
+            _ownsFd = false;
+            if(enabled && strcmp(sink, "memory") != 0)
+            {
+                char* end;
+                long fd = strtol(sink, &end, 10);
+                if(*end != 0)
+                {
+                    string path = sink;
+                    if(game >= 0)
+                    {
+                        path += "." + to_string(game);
+                    }
+                    _fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+                    _ownsFd = _fd >= 0;
+                }
+                else if(fd > 1 && fd <= INT_MAX && game < 0)
+                {
+                    _fd = fd;
+                }
+                if(_fd < 0)
+                {
+                    cerr << "Telemetry : sink " << sink << " rejected" << endl;
+                    enabled = false;
+                }
+            }
+            turn = -1;
+            _phaseCount = 0;
+        }
+        
+        ~Telemetry()
+        {
+            if(_ownsFd)
+            {
+                close(_fd);
+            }
+        }
+        
+        void startTurn()
+        {
+            turn++;
+            _phaseCount = 0;
+            if(enabled)
+            {
+                _last = chrono::steady_clock::now();
+            }
+        }
+        
+        //Close the phase started at the previous mark
+        void mark(const char* phase)
+        {
+            if(!enabled || _phaseCount == TELEMETRY_MAX_PHASES)
+            {
+                return;
+            }
+            chrono::steady_clock::time_point now = chrono::steady_clock::now();
+            _phases[_phaseCount].name = phase;
+            _phases[_phaseCount].micros = chrono::duration_cast<chrono::microseconds>(now - _last).count();
+            _phaseCount++;
+            _last = now;
+        }
+        
+        void writePhases(ostream& out)
+        {
+            long long total = 0;
+            out << "{";
+            for(int i = 0; i < _phaseCount; i++)
+            {
+                out << "\"" << _phases[i].name << "\":" << _phases[i].micros << ",";
+                total += _phases[i].micros;
+            }
+            out << "\"total\":" << total << "}";
+        }
+        
+        void write(const string& line)
+        {
+            if(_fd < 0)
+            {
+                buffer += line;
+                return;
+            }
+            size_t done = 0;
+            while(done < line.size())
+            {
+                ssize_t n = ::write(_fd, line.data() + done, line.size() - done);
+                if(n <= 0)
+                {
+                    enabled = false;
+                    return;
+                }
+                done += n;
+            }
+        }
+    
+    private:
+        struct Phase {
+            const char* name;
+            long long micros;
+        };
+        int _fd;
+        bool _ownsFd;                       // opened from a path
+        Phase _phases[TELEMETRY_MAX_PHASES];
+        int _phaseCount;
+        chrono::steady_clock::time_point _last;
+};
+
+/*
+  Neighbours of a zone, stored as ids and seen as zones
+*/
+struct ZoneLinks {
+    struct iterator {
+        const int* neighbour;
+        
+        Zone* operator*() const
+        {
+            return zonesById[*neighbour];
+        }
+        
+        iterator& operator++()
+        {
+            neighbour++;
+            return *this;
+        }
+        
+        bool operator!=(const iterator& other) const
+        {
+            return neighbour != other.neighbour;
+        }
+    };
+    
+    const int* first;
+    const int* last;
+    
+    iterator begin() const
+    {
+        return {first};
+    }
+    
+    iterator end() const
+    {
+        return {last};
+    }
+    
+    size_t size() const
+    {
+        return last - first;
+    }
+};
+
 /*
   represent a Tile on map.
   Zone belonging to a continent.
@@ -101,34 +688,49 @@ Overmind* overmind;
 */
 class Zone {
     public:
+        //State read each turn, packed at the head of the zone
+        signed char owner;          // the player who owns this zone (-1 otherwise)
+        signed char platinum;       // platinium in this zone, 0 to 6
+        signed char myId;           // Player Id;
+        unsigned char linkCount;    // number of neighbours
+        short myPods;               // Player's pods, even if player get 3 as Id, his pods will still be there
+        short p1;                   // player 1's PODs on this zone
+        short p2;                   // player 2's PODs on this zone
+        short p3;                   // player 3's PODs on this zone
+        short podDanger;            // potentiel enemy value for the next turn;
+        bool changed;               // owner, enemy pods or danger changed since last turn
+        int value;                  // value fixed by the overlord
+        
         int id;                     // this zone's ID
-        int platinum;               // platinium in this zone
-        int owner;                  // the player who owns this zone (-1 otherwise)
-        int myPods;                 // Player's pods, even if player get 3 as Id, his pods will still be there
-        vector<Zone*> links;        // neighbours
-        int p1;                     // player 1's PODs on this zone
-        int p2;                     // player 2's PODs on this zone
-        int p3;                     // player 3's PODs on this zone
+        int index;                  // position in 'zones', used by every dense array
+        const int* neighbours;      // ids of the neighbours, in the parsed or mapped adjacency
         Continent* continent;       // continent where the zone is
-
-        int myId;                   // Player Id;
-        int value;                  // value fixed by the overlord
-        int podDanger;              // potentiel enemy value for the next turn;
+        Cluster* cluster;           // cluster of the continent where the zone is
         
-        bool blacklisted;           // usefull to build continent
         Zone* ancestor;             // usefull with pathfinding
+        int visited;                // last path finding which reached this zone
+        
+        unsigned long long stateKey;    // zobrist key of this zone's state
+        unsigned long long localHash;   // xor of the state keys of this zone and its neighbours
         
         Zone(int playerId)
         {
             platinum = 0;
+            owner = -1;
+            stateKey = 0;
+            localHash = 0;
             _podIntend = 0;
             myPods = 0;
             p1 = 0;
             p2 = 0;
             p3 = 0;
-            blacklisted = false;
+            neighbours = nullptr;
+            linkCount = 0;
             myId = playerId;
             podDanger = 0;
+            cluster = nullptr;
+            visited = 0;
+            changed = true;
         }
         
         //Zone's flags
@@ -137,6 +739,23 @@ class Zone {
             return (owner == -1);
         }
         
+        ZoneLinks links()
+        {
+            return {neighbours, neighbours + linkCount};
+        }
+        
+        void setLinks(const int* ids, int count)
+        {
+            //Dropping a link would silently change the map, better stop at once
+            if(count > MAX_NEIGHBOURS)
+            {
+                cerr << "Zone " << id << " has more than " << MAX_NEIGHBOURS << " neighbours" << endl;
+                exit(1);
+            }
+            neighbours = ids;
+            linkCount = count;
+        }
+        
         bool isMine() 
         {
             return owner == myId;
@@ -225,7 +844,7 @@ class Zone {
         {
             bool result = isPeacefull();
             if(result){
-                for(Zone* z : links)
+                for(Zone* z : links())
                 {
                     if(!isPeacefull())
                     {
@@ -255,21 +874,22 @@ class Zone {
         void addIntend(int i)
         {
             _podIntend += i;
-            
+            refreshZoneKey(this);
         }
         
         bool isOnWar()
         {
-            return hasEnemyPodOnIt() && hasFriendOnIt();
+            return getMaxEnemyPod() > 0 && hasFriendOnIt();
         }
         
         //Zone's methods
         void clearIntend()
         {
             _podIntend = 0;
+            refreshZoneKey(this);
         }
     private :
-        int _podIntend;              // number of pod intend to move on this zone
+        short _podIntend;            // number of pod intend to move on this zone
 };
 
 
@@ -285,15 +905,115 @@ class ZoneIntend {
         Zone* zone;
         int distance;
         int weight;
+        vector<Zone*> path;         // zones crossed from the first step to the target
         
         ZoneIntend()
         {
+            turnCounters.intendAllocations++;
             zone = nullptr;
             distance = 0;
             weight = 0;
         }
 };
 
+/*
+  Fixed size transposition tables keyed by zobrist hashes.
+  - zone values, keyed by the neighbourhood hash mixed with the continent context
+  - best next hop of each mood, keyed by the neighbourhood hash of the origin
+  Collisions simply replace the previous entry.
+*/
+class TranspositionCache {
+    public:
+        long long valueProbes;
+        long long valueHits;
+        long long moodProbes;
+        long long moodHits;
+        
+        TranspositionCache()
+        {
+            _values.resize(CACHE_SIZE);
+            _moods.resize(CACHE_SIZE);
+            for(MoodEntry& e : _moods)
+            {
+                e.key = 0;
+                e.known = 0;
+            }
+            for(ValueEntry& e : _values)
+            {
+                e.key = 0;
+                e.value = 0;
+            }
+            valueProbes = 0;
+            valueHits = 0;
+            moodProbes = 0;
+            moodHits = 0;
+        }
+        
+        bool probeValue(unsigned long long key, int& value)
+        {
+            ValueEntry& e = _values[key & (CACHE_SIZE - 1)];
+            valueProbes++;
+            if(e.key == key)
+            {
+                valueHits++;
+                value = e.value;
+                return true;
+            }
+            return false;
+        }
+        
+        void storeValue(unsigned long long key, int value)
+        {
+            ValueEntry& e = _values[key & (CACHE_SIZE - 1)];
+            e.key = key;
+            e.value = value;
+        }
+        
+        bool probeMood(unsigned long long key, int mood, int& hop)
+        {
+            MoodEntry& e = _moods[key & (CACHE_SIZE - 1)];
+            moodProbes++;
+            if(e.key == key && (e.known & (1 << mood)))
+            {
+                moodHits++;
+                hop = e.hop[mood];
+                return true;
+            }
+            return false;
+        }
+        
+        void storeMood(unsigned long long key, int mood, int hop)
+        {
+            MoodEntry& e = _moods[key & (CACHE_SIZE - 1)];
+            if(e.key != key)
+            {
+                e.key = key;
+                e.known = 0;
+            }
+            e.known |= 1 << mood;
+            e.hop[mood] = hop;
+        }
+        
+        void report()
+        {
+            cerr << "Cache values : " << valueHits << "/" << valueProbes << " (" << (valueHits * 100) / max(1LL, valueProbes) << "%)";
+            cerr << ", moods : " << moodHits << "/" << moodProbes << " (" << (moodHits * 100) / max(1LL, moodProbes) << "%)" << endl;
+        }
+    
+    private:
+        struct ValueEntry {
+            unsigned long long key;
+            int value;
+        };
+        struct MoodEntry {
+            unsigned long long key;
+            unsigned int known;         // bit i : hop of mood i is known
+            int hop[MAX_MOODS];
+        };
+        vector<ValueEntry> _values;
+        vector<MoodEntry> _moods;
+};
+
 /*
   Moods are global attitudes.
   - 'name' is the mood's name
@@ -303,6 +1023,7 @@ class ZoneIntend {
   - <optionnal> 'condition' conditional catcher for immobility
   - <optionnal> 'conditionValue' weigth of immobility
   - 'possibleZone' number of zone responding to the catcher by continent
+  - 'index' position of the mood in its continent's list, used by the cache
 */
 class Mood {
     public:
@@ -315,6 +1036,7 @@ class Mood {
             _defaultValue = value;
             _catcher = seekedZone;
             _isConditionnal = false;
+            _seeksForeignZones = false;
         }
         
         Mood(string name, int value, function<bool (Zone*)> seekedZone, function<bool (Zone*)> condition, int conditionValue)
@@ -324,23 +1046,26 @@ class Mood {
             _defaultValue = value;
             _catcher = seekedZone;
             _isConditionnal = true;
+            _seeksForeignZones = false;
             _condition = condition;
             _conditionValue = conditionValue;
         }
         
-        ZoneIntend* getIntend(Zone* currentZone)
+        //Targets farther than 'maxDistance' are ignored
+        ZoneIntend* getIntend(Zone* currentZone, int maxDistance)
         {
             if(_isConditionnal && _condition(currentZone)){
                 ZoneIntend* result = new ZoneIntend();
                 result->weight = _conditionValue;
                 result->zone = currentZone;
+                return result;
             }
             else{
-                return getIntendedZone(currentZone);
+                return getIntendedZone(currentZone, maxDistance);
             }
         }
         
-        ZoneIntend* getIntendedZone(Zone* currentZone)
+        ZoneIntend* getIntendedZone(Zone* currentZone, int maxDistance)
         {
             ZoneIntend* result;
             if(isDisabled())
@@ -349,9 +1074,26 @@ class Mood {
                 result->weight = MIN_WEIGHT_RATIO;
             }
             else{
+                //A neighbour matching the catcher only depends on the neighbourhood state.
+                //The origin's own intend is left out of the key, the origin catcher is checked instead.
+                unsigned long long key = currentZone->localHash
+                    ^ zobristKey(currentZone->id, ZOBRIST_INTEND, currentZone->getIntend())
+                    ^ zobristKey(currentZone->id, ZOBRIST_ORIGIN, _index);
+                int hop;
+                if(exactShortcuts && cache->probeMood(key, _index, hop) && !catches(currentZone))
+                {
+                    result = new ZoneIntend();
+                    result->zone = zones[hop];
+                    result->path.push_back(result->zone);
+                    result->distance = 1;
+                    result->weight = _baseValue - result->distance;
+                    return result;
+                }
                 result = pathFinding(
                     currentZone,
-                    _catcher);
+                    _catcher,
+                    this,
+                    maxDistance);
                 if(result->zone == nullptr)
                 {
                     result->weight = MIN_WEIGHT_RATIO;
@@ -359,6 +1101,10 @@ class Mood {
                 else
                 {
                     result->weight = _baseValue - result->distance;
+                    if(result->distance == 1 && result->zone != currentZone)
+                    {
+                        cache->storeMood(key, _index, result->zone->index);
+                    }
                 }
             }
             return result;
@@ -389,6 +1135,45 @@ class Mood {
             return _catcher;
         }
         
+        bool catches(Zone* z)
+        {
+            turnCounters.catcherCalls[_index]++;
+            return _catcher(z);
+        }
+        
+        int getBaseValue()
+        {
+            return _baseValue;
+        }
+        
+        //Best weight this mood can give on 'currentZone' ; path finding reports a caught origin at distance 1, as its neighbours
+        int getBestWeight(Zone* currentZone)
+        {
+            int distance = _seeksForeignZones ? max(1, frontierDistance(currentZone)) : 1;
+            return max(getConditionWeight(currentZone), _baseValue - distance);
+        }
+        
+        //The catcher only accepts zones we do not own
+        void setSeeksForeignZones()
+        {
+            _seeksForeignZones = true;
+        }
+        
+        bool seeksForeignZones()
+        {
+            return _seeksForeignZones;
+        }
+        
+        //Weight of staying on 'currentZone', MIN_WEIGHT_RATIO if the mood has no such condition
+        int getConditionWeight(Zone* currentZone)
+        {
+            if(_isConditionnal && _condition(currentZone))
+            {
+                return _conditionValue;
+            }
+            return MIN_WEIGHT_RATIO;
+        }
+        
         void clearPossibleZones()
         {
             _possibleZone = 0;
@@ -398,6 +1183,16 @@ class Mood {
         {
             _possibleZone++;
         }
+        
+        int getIndex()
+        {
+            return _index;
+        }
+        
+        void setIndex(int index)
+        {
+            _index = index;
+        }
     
     private:
         string _name;
@@ -407,7 +1202,99 @@ class Mood {
         function<bool (Zone*)> _condition;
         int _possibleZone;
         bool _isConditionnal;
+        bool _seeksForeignZones;
         int _conditionValue;
+        int _index;
+};
+
+/*
+  A small connected group of zones of a continent, a node of the continent's cluster graph.
+  It counts, for each mood, the zones the mood's catcher accepts.
+  A zone changing only marks itself dirty, its catchers are called again when a count is asked.
+*/
+class Cluster {
+    public:
+        int index;                          // position in its continent's list
+        vector<Zone*> zones;
+        vector<Cluster*> links;             // clusters holding a neighbour of one of our zones
+        
+        Cluster(int position)
+        {
+            index = position;
+            _dirty = ~0u;
+            for(int m = 0; m < MAX_MOODS; m++)
+            {
+                _targets[m] = 0;
+            }
+        }
+        
+        //Zones and linked clusters are not owned
+        void addZone(Zone* z)
+        {
+            zones.push_back(z);
+            _caught.push_back(0);
+            _zoneDirty.push_back(~0u);
+        }
+        
+        void markDirty(Zone* z)
+        {
+            int i = find(zones.begin(), zones.end(), z) - zones.begin();
+            _zoneDirty[i] = ~0u;
+            _dirty = ~0u;
+        }
+        
+        int getTargets(Mood* m)
+        {
+            unsigned int bit = 1u << m->getIndex();
+            if(_dirty & bit)
+            {
+                for(size_t i = 0; i < zones.size(); i++)
+                {
+                    if(!(_zoneDirty[i] & bit))
+                    {
+                        continue;
+                    }
+                    _zoneDirty[i] &= ~bit;
+                    bool caught = m->catches(zones[i]);
+                    if(caught != ((_caught[i] & bit) != 0))
+                    {
+                        _caught[i] ^= bit;
+                        _targets[m->getIndex()] += caught ? 1 : -1;
+                    }
+                }
+                _dirty &= ~bit;
+            }
+            return _targets[m->getIndex()];
+        }
+    
+    private:
+        unsigned int _dirty;                // moods with a dirty zone
+        int _targets[MAX_MOODS];
+        vector<unsigned int> _caught;       // bit i : zone caught by mood i
+        vector<unsigned int> _zoneDirty;    // bit i : zone to check again for mood i
+};
+
+/*
+  View over a contiguous slice of 'zones'
+*/
+struct ZoneRange {
+    int first;
+    int count;
+    
+    vector<Zone*>::iterator begin() const
+    {
+        return zones.begin() + first;
+    }
+    
+    vector<Zone*>::iterator end() const
+    {
+        return zones.begin() + first + count;
+    }
+    
+    int size() const
+    {
+        return count;
+    }
 };
 
 /*
@@ -416,12 +1303,12 @@ class Mood {
 class Continent {
     public:
         int id;                             // Continent's id
-        string name;
         int platinum;                       // Platinum amount on this continent
         int wealthConcentration;            // Platinum density ratio
         int value;                          // Total value estimated by the overmind
-        vector<Zone*> myZones;              // Zone of the continent
-        vector<Mood*> moods;                // Available moods
+        ZoneRange myZones;                  // Zone of the continent, a slice of 'zones'
+        vector<Cluster*> clusters;          // Clusters of the continent, owned
+        vector<Mood*> moods;                // Available moods, owned by the overlord
         bool isOwned;                       // is totally owned by player
         bool isLost;                        // is totally lost by player
         int myPods; 												// Number of main player pods on this continent
@@ -442,25 +1329,33 @@ class Continent {
             p2 = 0;
             p3 = 0;
             platinumZoneOccupied= false;
-            
+            myZones.first = 0;
+            myZones.count = 0;
+        }
+        
+        ~Continent()
+        {
+            for(Cluster* c : clusters)
+            {
+                delete c;
+            }
+        }
+        
+        //Name for the logs
+        const char* getName()
+        {
             switch(id)
             {
                 case (0):
-                    name = "North_America";
-                break;
+                    return "North_America";
                 case (1):
-                    name = "South_Am.Africa";
-                break;
-                    
+                    return "South_Am.Africa";
                 case (2):
-                    name = "Enrasia";
-                break;
+                    return "Enrasia";
                 case (3):
-                    name = "Oceania";
-                break;
+                    return "Oceania";
                 default:
-                    name = "Japan";
-                break;
+                    return "Japan";
             }
         }
         
@@ -469,9 +1364,17 @@ class Continent {
             return moods;
         }
         
+        //Moods by decreasing base value, the list order breaking ties
+        vector<Mood*>& getMoodsByValue()
+        {
+            return _moodsByValue;
+        }
+        
         void setMoods(vector<Mood*> m)
         {
             moods = m;
+            _moodsByValue = m;
+            stable_sort(_moodsByValue.begin(), _moodsByValue.end(), [] (Mood* a, Mood* b) { return a->getBaseValue() > b->getBaseValue();});
         }
         
         int getSize()
@@ -479,11 +1382,73 @@ class Continent {
             return myZones.size();
         }
         
-        void computeWealthConcentration()
+        //Is there a zone of this continent caught by the mood
+        bool hasTargets(Mood* m)
         {
-            wealthConcentration = float((float)platinum/getSize()) * WEALTH_CONCENTRATION_FACTOR;
-        }
-        
+            for(Cluster* c : clusters)
+            {
+                if(c->getTargets(m) > 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+        
+        //Cluster hops from each cluster to the nearest one holding a target of the mood,
+        //FRONTIER_UNREACHABLE when there is none. A zone path is never shorter.
+        //The graph is searched again only when a cluster gains its first target or loses its last.
+        const vector<int>& getClusterDistances(Mood* m)
+        {
+            vector<int>& distance = _clusterDistances[m->getIndex()];
+            vector<char>& holds = _clusterHoldsTargets[m->getIndex()];
+            bool changed = distance.empty();
+            if(changed)
+            {
+                distance.assign(clusters.size(), FRONTIER_UNREACHABLE);
+                holds.assign(clusters.size(), 0);
+            }
+            for(Cluster* c : clusters)
+            {
+                char h = c->getTargets(m) > 0;
+                if(h != holds[c->index])
+                {
+                    holds[c->index] = h;
+                    changed = true;
+                }
+            }
+            if(changed)
+            {
+                _clusterQueue.clear();
+                for(Cluster* c : clusters)
+                {
+                    distance[c->index] = holds[c->index] ? 0 : FRONTIER_UNREACHABLE;
+                    if(holds[c->index])
+                    {
+                        _clusterQueue.push_back(c);
+                    }
+                }
+                for(size_t i = 0; i < _clusterQueue.size(); i++)
+                {
+                    Cluster* c = _clusterQueue[i];
+                    for(Cluster* l : c->links)
+                    {
+                        if(distance[l->index] == FRONTIER_UNREACHABLE)
+                        {
+                            distance[l->index] = distance[c->index] + 1;
+                            _clusterQueue.push_back(l);
+                        }
+                    }
+                }
+            }
+            return distance;
+        }
+        
+        void computeWealthConcentration()
+        {
+            wealthConcentration = float((float)platinum/getSize()) * WEALTH_CONCENTRATION_FACTOR;
+        }
+        
         void computeValue()
         {
             value = wealthConcentration + getSize();
@@ -526,6 +1491,12 @@ class Continent {
         {
             intends = 0;
         }
+    
+    private:
+        vector<Mood*> _moodsByValue;
+        vector<int> _clusterDistances[MAX_MOODS];
+        vector<char> _clusterHoldsTargets[MAX_MOODS];
+        vector<Cluster*> _clusterQueue;
 };
 
 /*
@@ -540,16 +1511,80 @@ class Pod {
         vector<string> debug;   // debug information       
         Mood* lastMood;  				// last mood
         Zone* intend;						// destination intend
+        bool planned;                   // move already decided by the planner
+        Zone* destination;              // zone the pod was sent to, where it is expected next turn
+        vector<Zone*> path;             // rest of the path toward the target of lastMood
+        Zone* target;                   // end of a path the pod was pulled away from, to route to again
         
         Pod(Zone* pos)
         {
+            turnCounters.podAllocations++;
             currentZone = pos;
             will = MIN_WEIGHT_RATIO;
+            lastMood = nullptr;
+            intend = nullptr;
+            planned = false;
+            destination = pos;
+            target = nullptr;
         }
         
         void move(Zone* z)
         {
             addMove(1, currentZone, z);
+            destination = z;
+        }
+        
+        //Forget the mood and path of a previous turn, the pod is moved by someone else
+        void dropPlan()
+        {
+            lastMood = nullptr;
+            path.clear();
+            target = nullptr;
+        }
+        
+        //Start a new turn on 'z', the path goes on if the pod made its step
+        void arrive(Zone* z)
+        {
+            target = nullptr;
+            if(!path.empty() && path.front() == z)
+            {
+                path.erase(path.begin());
+            }
+            else if(!path.empty())
+            {
+                target = path.back();
+                path.clear();
+            }
+            currentZone = z;
+            destination = z;
+            planned = false;
+            intend = nullptr;
+        }
+        
+        //Go on with last turn's path, while its target is still caught and nothing changed on the way.
+        //A pod pulled away from its path is routed again to the same target.
+        bool followPath()
+        {
+            if(POD_PLAN_REUSE && path.empty() && target != nullptr && target != currentZone)
+            {
+                routeTo(currentZone, target, path);
+            }
+            target = nullptr;
+            if(!POD_PLAN_REUSE || path.empty() || lastMood == nullptr || currentZone->changed || !lastMood->catches(path.back()))
+            {
+                return false;
+            }
+            for(Zone* z : path)
+            {
+                if(z->changed)
+                {
+                    return false;
+                }
+            }
+            intend = path.front();
+            will = lastMood->getBaseValue() - path.size();
+            move(intend);
+            return true;
         }
         
         Continent* getContinent()
@@ -560,42 +1595,100 @@ class Pod {
         void handleWar()
         {
             currentZone->p1 = max(0, currentZone->p1 - 1);
-            currentZone->p2 = max(0, currentZone->p1 - 1);
-            currentZone->p3 = max(0, currentZone->p1 - 1);
+            currentZone->p2 = max(0, currentZone->p2 - 1);
+            currentZone->p3 = max(0, currentZone->p3 - 1);
+            refreshZoneKey(currentZone);
         }
         
+        //Moods are tried by decreasing base value. A mood is skipped when its best weight
+        //cannot beat the current will, otherwise its search stops at the last distance that can.
+        //Equal weights go to the first mood of the list, so the result is the one of a full evaluation.
         void update()
         {
+            if(!startUpdate())
+            {
+                return;
+            }
+            for(Mood* m : getContinent()->getMoodsByValue())
+            {
+                //clock_t start;
+                //start = clock();
+                
+                evaluate(m);
+                
+                //int duration = ((clock() - start ) * 1000 )/ ((double)CLOCKS_PER_SEC);
+                //stringstream s;
+                //s << "Update mood " << m->getName() << " time : " << duration  << "ms" << endl;
+                //debug.push_back(s.str());
+            }
+            finishUpdate();
+        }
+        
+        //True when the pod needs no mood : planned, on war or following its path.
+        //Also the whole decision of a pod left without planning time.
+        bool keepCourse()
+        {
+            if(planned)
+            {
+                return true;
+            }
             if(currentZone->hasEnemyPodOnIt())
             {
+                path.clear();
                 handleWar();
+                return true;
             }
-            else{
-                intend = nullptr;
-                for(Mood* m : getContinent()->getMoods())
-                {
-                    //clock_t start;
-                    //start = clock();
-                    
-                    ZoneIntend* zi = m->getIntend(currentZone);
-                    if(zi->weight > will)
-                    {
-                        intend = zi->zone;
-                        will = zi->weight;
-                        lastMood = m;
-                    }
-                    
-                    //int duration = ((clock() - start ) * 1000 )/ ((double)CLOCKS_PER_SEC);
-                    //stringstream s;
-                    //s << "Update mood " << m->getName() << " time : " << duration  << "ms" << endl;
-                    //debug.push_back(s.str());
-                }
-                
-                if(intend != nullptr && intend != currentZone)
+            return followPath();
+        }
+        
+        //False when the pod needs no mood
+        bool startUpdate()
+        {
+            if(keepCourse())
+            {
+                return false;
+            }
+            turnCounters.podsEvaluated++;
+            intend = nullptr;
+            will = MIN_WEIGHT_RATIO;
+            lastMood = nullptr;
+            path.clear();
+            return true;
+        }
+        
+        //Moods are evaluated by decreasing base value, the best intend so far is kept
+        void evaluate(Mood* m)
+        {
+            int maxDistance = MAX_BOARD_DISTANCE;
+            bool winsTies = true;
+            if(lastMood != nullptr)
+            {
+                winsTies = m->getIndex() < lastMood->getIndex();
+                int needed = winsTies ? will : will + 1;
+                if(exactShortcuts && m->getBestWeight(currentZone) < needed)
                 {
-                    //cerr << "Pod on Z-" << currentZone->id << ", will : " << will << endl;  
-                    move(intend);
+                    return;
                 }
+                maxDistance = exactShortcuts ? m->getBaseValue() - needed : MAX_BOARD_DISTANCE;
+            }
+            
+            ZoneIntend* zi = m->getIntend(currentZone, maxDistance);
+            if(zi->weight > will || (zi->weight == will && lastMood != nullptr && winsTies))
+            {
+                intend = zi->zone;
+                will = zi->weight;
+                lastMood = m;
+                path.swap(zi->path);
+            }
+            delete zi;
+        }
+        
+        void finishUpdate()
+        {
+            if(intend != nullptr && intend != currentZone)
+            {
+                //cerr << "Pod on Z-" << currentZone->id << ", will : " << will << endl;  
+                move(intend);
             }
         }
 };
@@ -619,7 +1712,15 @@ class Overlord {
             c->setMoods(moods);
         }
         
-        vector<Zone*> getZones()
+        ~Overlord()
+        {
+            for(Mood* m : moods)
+            {
+                delete m;
+            }
+        }
+        
+        ZoneRange getZones()
         {
             return continent->myZones;
         }
@@ -672,7 +1773,7 @@ class Overlord {
                 
                 for(Mood* m : moods)
                 {
-                    if(m->getCatcher()(z))
+                    if(m->catches(z))
                     {
                         m->incrementPossibleZones();
                     }
@@ -706,7 +1807,7 @@ class Overlord {
 class Overmind
 {
     public:
-        vector<Overlord*> overlords;        // Overlords list
+        vector<Overlord*> overlords;        // Overlords list, without the ignored ones
         int playerCount;                    // Number of playes
         int myId;                           // Id identifier
         int zoneCount;                      // total number of zones                         
@@ -714,11 +1815,23 @@ class Overmind
         int platinum;                       // Platinum ressources
         int worldValue;                     // total Value
         bool isFirstTurn; 									// flag for the first turn
+        unsigned long long mapFingerprint;  // key of the opening book
+        unsigned long long mapChecksum;     // of the map lines of stdin, see MapFile
+        vector<int> neighbourIds;           // neighbours of each zone of a parsed map, the zones point into it
+        
+        ~Overmind()
+        {
+            for(Overlord* o : _spawned)
+            {
+                delete o;
+            }
+        }
         
         void spawnOverlord(Continent* c)
         {
             Overlord* o = new Overlord(c);
             overlords.push_back(o);
+            _spawned.push_back(o);
             worldValue = 0;
             o->moods = initMoods();
             o->continent->setMoods(o->moods);
@@ -739,8 +1852,8 @@ class Overmind
         void purchasePod(int count, Zone* destination)
         {
             
-            if(!destination->isHostil() && platinum >= POD_PRICE){
-                platinum -= POD_PRICE;
+            if(!destination->isHostil() && platinum >= POD_PRICE * count){
+                platinum -= POD_PRICE * count;
                 addCreate(count, destination);
                 cerr << " Purchased " << count << " pod on " << destination->id << ", value : " << destination->value << endl;
                 cerr << " platinum left " << platinum << endl;
@@ -765,10 +1878,6 @@ class Overmind
             }
         }
         
-        static bool zoneCompareLess(const Zone* lhs, const Zone* rhs)
-        {
-            return lhs->value > rhs->value;
-        }
         
         static bool platinumCompareLess(const Zone* lhs, const Zone* rhs)
         {
@@ -817,13 +1926,23 @@ class Overmind
                  [] (Zone* z) { return !z->isMine() && !z->hasIntend();}
             );
             
+            greediness->setSeeksForeignZones();
+            slowExpand->setSeeksForeignZones();
+            conquest->setSeeksForeignZones();
+            defaultMood->setSeeksForeignZones();
+            
             //moods.push_back(aggressive);
+            delete aggressive;                  // not in use
             moods.push_back(defensive);
             moods.push_back(greediness);
             moods.push_back(slowExpand);
             moods.push_back(conquest);
             moods.push_back(defaultMood);
             
+            for(size_t i = 0; i < moods.size(); i++)
+            {
+                moods[i]->setIndex(i);
+            }
             return moods;
         }
         
@@ -831,6 +1950,18 @@ class Overmind
         {
             int value = 0;
             
+            //The first turn has its own rules
+            unsigned long long key = z->localHash ^ zobristKey(z->id, ZOBRIST_ORIGIN, -1) ^ mix64(
+                ZOBRIST_SEED
+                ^ ((unsigned long long)z->continent->getMaxEnemyPod() << 8)
+                ^ (z->continent->isIgnored() << 1)
+                ^ z->continent->platinumZoneOccupied);
+            bool isCacheable = !isFirstTurn;
+            if(isCacheable && exactShortcuts && cache->probeValue(key, z->value))
+            {
+                return;
+            }
+            
             //if zone is secure, it looses all his value
             if(z->isHostil() || z->continent->isIgnored()  || z->continent->platinumZoneOccupied)
             {
@@ -839,7 +1970,6 @@ class Overmind
             else{
                 //base Value is platinum on it
                 if(isFirstTurn){
-                    isFirstTurn = false;
                     if(true)
                     {
                         if(z->platinum == 2)
@@ -876,7 +2006,7 @@ class Overmind
                 value += z->getMaxEnemyPod();
                 value += z->podDanger;
 
-                for(Zone* l : z->links)
+                for(Zone* l : z->links())
                 {
                     value += l->platinum;
                     if(l->isHostil())
@@ -888,378 +2018,5277 @@ class Overmind
             }
             //cerr << "Zone " << z->id << ", value : " << value << endl;
             z->value = value;
+            if(isCacheable)
+            {
+                cache->storeValue(key, value);
+            }
         }
         
-        void update()
+        //Fingerprint of the map, from the point of view of our player.
+        //Links are summed, so it does not depend on their order or on the zone order of a map file.
+        void computeMapFingerprint()
         {
-            getOverlordsFeedBack();
-            vector<Zone*> sortedList = zones;
-            int i = 0;
-            while(platinum >= POD_PRICE)
+            mapFingerprint = mix64(ZOBRIST_SEED ^ ((unsigned long long)playerCount << 8) ^ myId);
+            for(Zone* z : zonesById)
             {
-                stable_sort(sortedList.begin(), sortedList.end(), zoneCompareLess);
-                Zone* z = sortedList[i];
-                purchasePod(1, z);
-                
-                if(isFirstTurn && (z->getIntend() >= z->links.size()))
+                unsigned long long links = 0;
+                for(Zone* l : z->links())
                 {
-                    z->value = 0;
+                    links += mix64(l->id);
                 }
-                if(isFirstTurn && playerCount > 2 && z->getIntend() > 1)
+                mapFingerprint = mix64(mapFingerprint ^ ((unsigned long long)z->platinum << 32) ^ z->linkCount) + links;
+            }
+        }
+        
+        //Purchases of the opening book, false if the map is unknown
+        bool playOpeningBook()
+        {
+            bool found = false;
+            for(const OpeningMove& m : OPENING_BOOK)
+            {
+                if(m.fingerprint == mapFingerprint && m.zone >= 0 && m.zone < (int)zonesById.size())
                 {
-                    z->value = 0;
+                    found = true;
+                    purchasePod(m.count, zonesById[m.zone]);
                 }
-                
-                if(isFirstTurn && playerCount > 3 && z->getIntend() > 0)
+            }
+            return found;
+        }
+        
+        void update()
+        {
+            getOverlordsFeedBack();
+            if(!isFirstTurn || !playOpeningBook())
+            {
+                purchasePods();
+            }
+            //Every zone and purchase of the first turn follow its rules, not only the first one scored
+            isFirstTurn = false;
+        }
+        
+        //Pods that can still be bought on 'z' this turn
+        int getPurchaseCap(Zone* z)
+        {
+            int maxIntend = PURCHASE_MAX_INTEND;
+            if(isFirstTurn)
+            {
+                maxIntend = min(maxIntend, (int)z->links().size());
+                if(playerCount > 3)
                 {
-                    z->value = 0;
+                    maxIntend = min(maxIntend, 1);
                 }
-                
-                if(z->getIntend() > 2)
+                else if(playerCount > 2)
                 {
-                    z->value = 0;
+                    maxIntend = min(maxIntend, 2);
                 }
-                
             }
-
+            return max(0, maxIntend - z->getIntend());
         }
-};
-
-/***********************************************************************************************************
-
-/** PATH FINTDING **/
-/*
-  Path finding with closure
-*/
-ZoneIntend* pathFinding(Zone* origin, function<bool (Zone*)> func)
-{
-    ZoneIntend* result = new ZoneIntend();
-    
-    vector<Zone*> blackList;
-    vector<Zone*> whiteList;
-    vector<Zone*> tempList;
-    
-    //Check the war case, unit cannot flee on ennemy zones.
-    if(origin->hasEnemyPodOnIt())
-    {
-        for(Zone* z : origin->links)
+        
+        //Pods needed on 'z' to win it, buying less is useless
+        int getPurchaseNeed(Zone* z)
+        {
+            return max(1, z->getMaxEnemyPod() + z->podDanger - z->myPods - z->getIntend() + 1);
+        }
+        
+        //Value of 'count' pods bought on 'z', each extra pod on the same zone is worth a bit less.
+        //A pod is always worth something, platinum is only kept for a better purchase.
+        int getPurchaseValue(Zone* z, int count)
         {
-            if(z->isHostil())
+            return count * max(1, z->value) - PURCHASE_STACK_PENALTY * count * (count - 1) / 2;
+        }
+        
+        //Platinum expected next turn from the zones we own
+        int getProjectedIncome()
+        {
+            int income = 0;
+            for(Zone* z : zones)
             {
-                blackList.push_back(z);
+                if(z->isMine())
+                {
+                    income += z->platinum;
+                }
             }
+            return income;
         }
-    }
-    
-    blackList.push_back(origin);
-    whiteList.push_back(origin);
-    
-    //Maybe add a recursion limit, like 9.
-    while(result->zone == nullptr && whiteList.size() != 0)
-    {
-        //cerr << "WhiteList " << whiteList.size() << endl;
-        for(Zone* z : whiteList)
+        
+        //Spend the platinum of this turn.
+        //Pods are shared between zones with a knapsack, a zone getting between its need and its cap.
+        //Some pods may be saved when a zone too expensive for this turn becomes affordable
+        //with the projected income, its value being discounted by PURCHASE_LOOKAHEAD_PERCENT.
+        void purchasePods()
         {
-            if (func(z))
+            vector<Zone*> candidates;
+            int capacity = 0;
+            for(Zone* z : zonesById)
             {
-                result->zone = z;
-                result->distance = 1;
-                
-                while(z->ancestor != origin)
+                if(!z->isHostil() && getPurchaseCap(z) > 0)
                 {
-                    z = z->ancestor;
-                    result->distance++;
-                    result->zone = z;
+                    candidates.push_back(z);
+                    capacity += getPurchaseCap(z);
                 }
             }
-            else
+            int budget = min(platinum / POD_PRICE, capacity);
+            if(budget <= 0)
+            {
+                return;
+            }
+            
+            //best[g][c] : best value of the first g candidates with c pods
+            int width = budget + 1;
+            vector<int> best((candidates.size() + 1) * width, 0);
+            vector<char> choice(candidates.size() * width, 0);
+            for(size_t g = 0; g < candidates.size(); g++)
             {
-                for(Zone* neighbour : z->links)
+                Zone* z = candidates[g];
+                int cap = getPurchaseCap(z);
+                int need = getPurchaseNeed(z);
+                turnCounters.purchaseCells += width;
+                for(int c = 0; c <= budget; c++)
                 {
-                    if(!(find(blackList.begin(), blackList.end(), neighbour)!=blackList.end()))
+                    int value = best[g * width + c];
+                    for(int k = need; k <= cap && k <= c; k++)
                     {
-                        neighbour->ancestor = z;
-                        tempList.push_back(neighbour);
+                        int v = best[g * width + c - k] + getPurchaseValue(z, k);
+                        if(v > value)
+                        {
+                            value = v;
+                            choice[g * width + c] = k;
+                        }
                     }
+                    best[(g + 1) * width + c] = value;
+                }
+            }
+            
+            //Zones out of reach this turn, by pods needed next turn
+            int incomePods = (platinum % POD_PRICE + getProjectedIncome()) / POD_PRICE;
+            int total = best[candidates.size() * width + budget];
+            int spent = budget;
+            vector<int> delayed(budget + incomePods + 1, 0);
+            for(Zone* z : candidates)
+            {
+                int need = getPurchaseNeed(z);
+                if(need > budget && need <= getPurchaseCap(z) && need <= budget + incomePods)
+                {
+                    int value = getPurchaseValue(z, need) * PURCHASE_LOOKAHEAD_PERCENT / 100;
+                    delayed[need] = max(delayed[need], value);
+                }
+            }
+            for(size_t c = 1; c < delayed.size(); c++)
+            {
+                delayed[c] = max(delayed[c], delayed[c - 1]);
+            }
+            total += delayed[incomePods];
+            for(int saved = 1; saved <= budget; saved++)
+            {
+                int value = best[candidates.size() * width + budget - saved] + delayed[saved + incomePods];
+                if(value > total)
+                {
+                    total = value;
+                    spent = budget - saved;
+                }
+            }
+            
+            for(int g = candidates.size() - 1; g >= 0 && spent > 0; g--)
+            {
+                int k = choice[g * width + spent];
+                if(k > 0)
+                {
+                    purchasePod(k, candidates[g]);
+                    spent -= k;
                 }
             }
         }
-        blackList.insert(blackList.end(), tempList.begin(), tempList.end());
-        whiteList = tempList;
-        tempList.clear();
-    }
-        
-    return result;
-}
-
-/** COMMANDS **/
-struct Move {
-    int podsCount;
-    Zone* zoneOrigin;
-    Zone* zoneDestination;
-};
-
-void addMove(int podsCount, Zone* zoneOrigin, Zone* zoneDestination)
-{
-    Move m;
-    m.podsCount = podsCount;
-    m.zoneOrigin = zoneOrigin;
-    m.zoneDestination = zoneDestination;
-    zoneOrigin->addIntend(-1);
-    zoneDestination->addIntend(1);
     
-    moves.push_back(m);
-}
-
-struct Create {
-    int podsCount;
-    Zone* zoneDestination;
+    private:
+        vector<Overlord*> _spawned;         // every overlord, ignored ones included, owned
 };
 
-void addCreate(int podsCount, Zone* zoneDestination)
-{
-    Create c;
-    c.podsCount = podsCount;
-    c.zoneDestination = zoneDestination;
-    zoneDestination->addIntend(1);
-    zoneDestination->continent->intends ++;
+/** BOARD **/
+/*
+  Read only array of ints, owned by the topology or mapped from a map file
+*/
+struct IntView {
+    const int* items;
+    int count;
     
-    creates.push_back(c);
-}
-
-/** INITIALIZATION **/
-// get the information given by the program at beginning
-void initOvermind()
-{
-    overmind = new Overmind();
+    void assign(const int* first, int size)
+    {
+        items = first;
+        count = size;
+    }
     
-    cin >> overmind->playerCount >> overmind->myId >> overmind->zoneCount >> overmind->linkCount; cin.ignore();
+    const int& operator[](int i) const
+    {
+        return items[i];
+    }
     
-    for (int i = 0; i < overmind->zoneCount; i++) {
-        Zone* z = new Zone(overmind->myId);
-        cin >> z->id >> z->platinum; cin.ignore();
-        zones.push_back(z);
-        
-        //cerr << "zone created : " << z->id << ", " << z->platinum << endl;
+    const int* data() const
+    {
+        return items;
     }
-    for (int i = 0; i < overmind->linkCount; i++) {
-        int zone1;
-        int zone2;
-        cin >> zone1 >> zone2; cin.ignore();
-        zones[zone1]->links.push_back(zones[zone2]);
-        zones[zone2]->links.push_back(zones[zone1]);
+    
+    int size() const
+    {
+        return count;
     }
-}
-
-//CONTINENTS
-//recurcive function to explore and identify continents.
-void rec_continent(Continent* c, Zone* z) 
-{
-    z->continent = c;
-    c->myZones.push_back(z);
-    c->platinum += z->platinum;
-    z->blacklisted = true;
     
-    for(Zone* neighbour : z->links)
+    const int* begin() const
     {
-        if(!neighbour->blacklisted)
-        {
-            rec_continent(c, neighbour);
-        }
+        return items;
     }
-}
+    
+    const int* end() const
+    {
+        return items + count;
+    }
+};
 
-//Initialize continents.
-void initContinents()
-{
-    int indexContinent = 0;
-    for(Zone* z : zones){
-        if(!z->blacklisted)
+/*
+  Static part of the board, shared by every snapshot.
+  Adjacency is stored as CSR : neighbours of zone i are
+  neighbours[offsets[i]] .. neighbours[offsets[i + 1] - 1]
+  Arrays are views, on 'storage' when the map is read from stdin, on the map file otherwise.
+*/
+struct BoardTopology {
+    int zoneCount;
+    IntView offsets;                    // zoneCount + 1 entries
+    IntView neighbours;                 // 2 * linkCount entries
+    IntView platinum;                   // platinum produced by each zone
+    IntView continentOf;                // continent of each zone
+    IntView continentOffsets;           // continentCount + 1 entries, zones of a continent are contiguous
+    vector<int> storage[5];             // arrays above, in the same order
+};
+
+/*
+  Flat and trivially copyable snapshot of the game state.
+  Players are stored by slot, like in Zone : slot 0 is us, slots 1..3 are p1..p3.
+  A fork is a plain copy, no pointer has to be fixed.
+  - 'owner' is the owner slot of each zone (-1 if neutral)
+  - 'pods' is the pods count of each slot on each zone
+  - 'platinum' is the platinum stock of each slot (we only know ours)
+*/
+struct Board {
+    int zoneCount;
+    int platinum[MAX_PLAYERS];
+    signed char owner[MAX_BOARD_ZONES];
+    short pods[MAX_PLAYERS][MAX_BOARD_ZONES];
+
+    //Convert a player id to its slot, from the point of view of player 'myId'
+    static int slotOf(int playerId, int myId)
+    {
+        if(playerId == -1)
         {
-            Continent* c = new Continent(indexContinent);
-            rec_continent(c, z);
-            continents.push_back(c);
-            
-            overmind->spawnOverlord(c);
-            
-            indexContinent++;
+            return -1;
+        }
+        if(playerId == myId)
+        {
+            return 0;
         }
+        return playerId < myId ? playerId + 1 : playerId;
     }
-    cerr << "Continents : " << endl;
-    for(Continent* c : continents)
+
+    //Snapshots only cover boards up to MAX_BOARD_ZONES zones
+    static bool canCapture()
     {
-        cerr << "name : " << c->name << endl;
-        cerr << "    size     : " << c->getSize() << endl;
-        cerr << "    platinum : " << c->platinum << endl;
-        c->computeWealthConcentration();
-        cerr << "    wealConc : " << c->wealthConcentration << endl;
-        c->computeValue();
-        cerr << "   Value     : " << c->value << endl;
-        overmind->worldValue += c->value;
-        cerr << endl;
+        return topology->zoneCount <= MAX_BOARD_ZONES;
     }
-    cerr << "----------------" << endl;
-    cerr << "World Value : " << overmind->worldValue << endl; 
-    cerr << endl;
-}
-
 
-/** UPDATE **/
-//UPDATE COMMANDS
-void updateCommands()
-{
-    //Move commands
-    stringstream command;
-    
-    if(moves.size() > 0){
-        for (const auto& m : moves)
+    //Snapshot of the current world
+    static Board capture()
+    {
+        Board b;
+        b.zoneCount = topology->zoneCount;
+        for(int s = 0; s < MAX_PLAYERS; s++)
         {
-            command << m.podsCount << " " << m.zoneOrigin->id << " " << m.zoneDestination->id << " ";
+            b.platinum[s] = 0;
         }
-    }
-    else{
-        command <<  "WAIT";
+        b.platinum[0] = overmind->platinum;
+        for(Zone* z : zones)
+        {
+            b.owner[z->index] = slotOf(z->owner, z->myId);
+            b.pods[0][z->index] = z->myPods;
+            b.pods[1][z->index] = z->p1;
+            b.pods[2][z->index] = z->p2;
+            b.pods[3][z->index] = z->p3;
+        }
+        return b;
     }
 
-    cout << command.str() << endl;
-    
-    //Create commands
-    command.str("");
-    
-    if(creates.size() > 0){
-        for (const auto& c : creates)
+    static bool isReachable(int from, int to)
+    {
+        for(int i = topology->offsets[from]; i < topology->offsets[from + 1]; i++)
         {
-            command << c.podsCount << " " << c.zoneDestination->id << " ";
+            if(topology->neighbours[i] == to)
+            {
+                return true;
+            }
         }
+        return false;
     }
-    else{
-        command << "WAIT";
+
+    //Move up to 'count' pods of 'slot' ; illegal moves are ignored, as the referee does
+    void applyMove(int slot, int count, int from, int to)
+    {
+        if(!isReachable(from, to))
+        {
+            return;
+        }
+        int moved = min(count, (int)pods[slot][from]);
+        pods[slot][from] -= moved;
+        pods[slot][to] += moved;
     }
 
-    cout << command.str() << endl;
-}
+    //Buy pods on a neutral or owned zone
+    void applyCreate(int slot, int count, int zone)
+    {
+        if(owner[zone] != -1 && owner[zone] != slot)
+        {
+            return;
+        }
+        int bought = min(count, platinum[slot] / POD_PRICE);
+        platinum[slot] -= bought * POD_PRICE;
+        pods[slot][zone] += bought;
+    }
 
-//UPDATE PLATINUM
-void updatePlatinum()
-{
-    cin >> overmind->platinum; cin.ignore();
-}
+    //Each round, every player present loses one pod, then the last one standing owns the zone
+    void resolveFight(int z)
+    {
+        for(int round = 0; round < MAX_FIGHT_ROUNDS; round++)
+        {
+            int present = 0;
+            for(int s = 0; s < MAX_PLAYERS; s++)
+            {
+                present += pods[s][z] > 0;
+            }
+            if(present < 2)
+            {
+                break;
+            }
+            for(int s = 0; s < MAX_PLAYERS; s++)
+            {
+                pods[s][z] = max(0, pods[s][z] - 1);
+            }
+        }
+        int survivor = -1;
+        int present = 0;
+        for(int s = 0; s < MAX_PLAYERS; s++)
+        {
+            if(pods[s][z] > 0)
+            {
+                survivor = s;
+                present++;
+            }
+        }
+        if(present == 1)
+        {
+            owner[z] = survivor;
+        }
+    }
+    
+    void resolveFights()
+    {
+        for(int z = 0; z < zoneCount; z++)
+        {
+            resolveFight(z);
+        }
+    }
 
-//UPDATE ZONES
-void updateZones()
-{
-    for (int i = 0; i < overmind->zoneCount; i++) {
-        Zone* z = zones[i];
+    void applyIncome()
+    {
+        for(int z = 0; z < zoneCount; z++)
+        {
+            if(owner[z] != -1)
+            {
+                platinum[owner[z]] += topology->platinum[z];
+            }
+        }
+    }
 
-        //In a worry of simplicity, pods are sorted.
-        switch(overmind->myId)
+    //Same owners and pods, platinum aside
+    bool hasSamePositions(const Board& b) const
+    {
+        if(zoneCount != b.zoneCount || memcmp(owner, b.owner, zoneCount * sizeof(owner[0])) != 0)
         {
-            case(0):
-                cin >> z->id >> z->owner >> z->myPods >> z->p1 >> z->p2 >> z->p3; cin.ignore();
-            break;
-            case(1):
-                cin >> z->id >> z->owner >> z->p1 >> z->myPods >> z->p2 >> z->p3; cin.ignore();
-            break;
-            case (2):
-                cin >> z->id >> z->owner >> z->p1 >> z->p2 >> z->myPods >> z->p3; cin.ignore();
-            break;
-            default:
-                cin >> z->id >> z->owner >> z->p1 >> z->p2 >> z->p3 >> z->myPods; cin.ignore();
-            break;
+            return false;
         }
-        if(z->myPods > 0){
-            for(int j = 0; j < z->myPods ; j++){
-                Pod* p = new Pod(z);
-                pods.push_back(p);
+        for(int s = 0; s < MAX_PLAYERS; s++)
+        {
+            if(memcmp(pods[s], b.pods[s], zoneCount * sizeof(pods[s][0])) != 0)
+            {
+                return false;
             }
-        };
-        z->continent->p1 += z->p1;
-        z->continent->p2 += z->p2;
-        z->continent->p3 += z->p3;
-        z->continent->myPods += z->myPods;
-        z->clearIntend();
-        
-        overmind->setZoneValue(z);
+        }
+        return true;
     }
-    for(Zone* z : zones)
+    
+    //Platinum produced each turn by the zones of 'slot'
+    int income(int slot) const
     {
-        z->podDanger = 0;
-        for(Zone* l: z->links)
+        int result = 0;
+        for(int z = 0; z < zoneCount; z++)
         {
-            z->podDanger += max(0, (l->getMaxEnemyPod() - l->myPods));
+            if(owner[z] == slot)
+            {
+                result += topology->platinum[z];
+            }
         }
+        return result;
     }
-}
+};
 
-//UPDATE OVERMIND
-void updateOvermind()
-{
-    overmind->update();
-}
+static_assert(is_trivially_copyable<Board>::value, "Board must stay a flat snapshot");
 
-//UPDATE PODS
-void updatePods()
-{
+//One int per board of a batch, GCC vector extension
+typedef int BatchLanes __attribute__((vector_size(BATCH_LANES * sizeof(int))));
+
+/*
+  BATCH_LANES boards stored side by side : every field holds one lane per board (structure of arrays).
+  Fights, captures and income are resolved for all the lanes with the same vector instructions,
+  moves stay scalar as each lane plays its own plan.
+  Comparisons of lanes give -1 where true and 0 elsewhere, they are used as masks.
+  Only the zones given to load() are meaningful, the others are never initialised.
+*/
+struct BatchBoard {
+    BatchLanes platinum[MAX_PLAYERS];
+    BatchLanes owner[MAX_BOARD_ZONES];
+    BatchLanes pods[MAX_PLAYERS][MAX_BOARD_ZONES];
     
-    for(Pod* p : pods)
+    //Every lane starts as a copy of 'b' on 'zones'
+    void load(const Board& b, const vector<int>& zones)
     {
-        //clock_t start;
-        //start = clock();
+        const BatchLanes zero = {};
+        for(int s = 0; s < MAX_PLAYERS; s++)
+        {
+            platinum[s] = zero + b.platinum[s];
+        }
+        for(int z : zones)
+        {
+            owner[z] = zero + b.owner[z];
+            for(int s = 0; s < MAX_PLAYERS; s++)
+            {
+                pods[s][z] = zero + b.pods[s][z];
+            }
+        }
+    }
     
-        
-        p->update();
-        if(!p->currentZone->continent->isIgnored() && p->lastMood != nullptr && p->intend != nullptr){
-            cerr << "pod : " << p->currentZone->id << ", choosen mood " << p->lastMood->getName() << ", go in " << p->intend->id << endl;;
+    //Same as Board::applyMove, on a single lane
+    void applyMove(int lane, int slot, int count, int from, int to)
+    {
+        if(!Board::isReachable(from, to))
+        {
+            return;
         }
-        
-        /*int duration = ((clock() - start ) * 1000 )/ ((double)CLOCKS_PER_SEC);
-        if(duration > 10)
+        int moved = min(count, pods[slot][from][lane]);
+        pods[slot][from][lane] -= moved;
+        pods[slot][to][lane] += moved;
+    }
+    
+    //Same as Board::resolveFight, on every lane ; a round without fight changes nothing
+    void resolveFight(int z)
+    {
+        for(int round = 0; round < MAX_FIGHT_ROUNDS; round++)
         {
-            cerr << "- Debug Pod : " << p->currentZone->id << endl;
-            for(string s : p->debug){
-                cerr << s << endl;
+            BatchLanes present = {};
+            for(int s = 0; s < MAX_PLAYERS; s++)
+            {
+                present -= pods[s][z] > 0;
             }
-        }*/
+            BatchLanes fighting = present >= 2;
+            for(int s = 0; s < MAX_PLAYERS; s++)
+            {
+                pods[s][z] += (pods[s][z] > 0) & fighting;
+            }
+        }
+        BatchLanes present = {};
+        for(int s = 0; s < MAX_PLAYERS; s++)
+        {
+            present -= pods[s][z] > 0;
+        }
+        BatchLanes alone = present == 1;
+        for(int s = 0; s < MAX_PLAYERS; s++)
+        {
+            BatchLanes survivor = alone & (pods[s][z] > 0);
+            owner[z] = (owner[z] & ~survivor) | (survivor & s);
+        }
     }
     
+    void resolveFights(const vector<int>& zones)
+    {
+        for(int z : zones)
+        {
+            resolveFight(z);
+        }
+    }
     
+    void applyIncome(const vector<int>& zones)
+    {
+        for(int z : zones)
+        {
+            for(int s = 0; s < MAX_PLAYERS; s++)
+            {
+                platinum[s] += (owner[z] == s) & topology->platinum[z];
+            }
+        }
+    }
+};
+
+/** HASHING **/
+/*
+  Zobrist hashing of the zones neighbourhood.
+  Each (zone, field, value) has its own random key, derived by mixing instead of a table
+  so pod counts are never clamped. A zone's stateKey is the xor of its fields keys,
+  its localHash the xor of its stateKey and its neighbours ones.
+  Two zones may share the same neighbourhood, lookups add the origin's key.
+  refreshZoneKey must be called whenever a hashed field changes.
+*/
+//splitmix64 finalizer
+unsigned long long mix64(unsigned long long x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
 }
 
-/** CLEAR **/
-void clear()
+//FNV-1a over the bytes of a line, then mixed in
+unsigned long long hashText(unsigned long long hash, const string& text)
 {
-    moves.clear();
-    creates.clear();
-    pods.clear();
-    for(Continent* c : continents)
+    unsigned long long h = 0xCBF29CE484222325ULL;
+    for(char c : text)
     {
-        c->clearPods();
-        c->clearIntends();
+        h = (h ^ (unsigned char)c) * 0x100000001B3ULL;
     }
+    return mix64(hash ^ h);
 }
 
-/** MAIN **/
-int main()
+unsigned long long zobristKey(int zoneId, int field, int value)
 {
-    initOvermind();
-    initContinents();
-    
-    // game loop
-    while (1) {
-        clock_t start;
-        start = clock();
+    return mix64(ZOBRIST_SEED ^ ((unsigned long long)(zoneId * 8 + field) << 32) ^ (unsigned int)value);
+}
+
+void refreshZoneKey(Zone* z)
+{
+    unsigned long long key = zobristKey(z->id, ZOBRIST_OWNER, z->owner)
+        ^ zobristKey(z->id, ZOBRIST_MY_PODS, z->myPods)
+        ^ zobristKey(z->id, ZOBRIST_P1, z->p1)
+        ^ zobristKey(z->id, ZOBRIST_P2, z->p2)
+        ^ zobristKey(z->id, ZOBRIST_P3, z->p3)
+        ^ zobristKey(z->id, ZOBRIST_DANGER, z->podDanger)
+        ^ zobristKey(z->id, ZOBRIST_INTEND, z->getIntend());
+    unsigned long long diff = key ^ z->stateKey;
+    if(diff == 0)
+    {
+        return;
+    }
+    z->stateKey = key;
+    z->localHash ^= diff;
+    for(Zone* l : z->links())
+    {
+        l->localHash ^= diff;
+    }
+    //The state key covers everything a catcher looks at
+    if(z->cluster != nullptr)
+    {
+        z->cluster->markDirty(z);
+    }
+}
+
+/** INFLUENCE **/
+/*
+  Influence map over the topology arrays.
+  The threat of a zone is the count of enemy pods not already contained by ours, weighted by
+  the departure rate the mobility model learnt for the strongest enemy there : only the pods
+  expected to leave reach another zone, at any hop. At 100% it is the plain count.
+  INFLUENCE_HOPS - 1 sweeps spread it : a zone keeps the strongest threats that reach it,
+  its own or the decayed ones of its neighbours, with the zone each one comes from.
+  The danger of a zone is the spread threat of its neighbours, leaving out what comes
+  from the zone itself, so one hop matches the historical podDanger.
+  The two strongest sources are kept, so the best one that is not the zone is always known.
+  The strength of each player is spread alongside : a zone keeps the max of its own pods and
+  the decayed strength of its neighbours. Players are interleaved in one PlayerStrength vector
+  by zone (ours first, then each enemy slot), so a sweep takes a max of vectors per link.
+*/
+//Strength of each player on a zone, ours first, GCC vector extension
+typedef float PlayerStrength __attribute__((vector_size(MAX_PLAYERS * sizeof(float))));
+
+struct InfluenceSource {
+    float value;
+    int zone;                           // -1 : no source
+};
+
+class InfluenceMap {
+    public:
+        vector<int> danger;
         
-        updatePlatinum();
-        updateZones();
-        updateOvermind();
-        updatePods();
-        updateCommands();
+        InfluenceMap(int zoneCount)
+        {
+            danger.assign(zoneCount, 0);
+            _strength.assign(zoneCount, PlayerStrength{});
+            _nextStrength.assign(zoneCount, PlayerStrength{});
+            _best.assign(zoneCount, {0, -1});
+            _second.assign(zoneCount, {0, -1});
+            _nextBest.assign(zoneCount, {0, -1});
+            _nextSecond.assign(zoneCount, {0, -1});
+        }
         
-        clear();
+        void compute()
+        {
+            for(Zone* z : zones)
+            {
+                setThreat(z->index, max(0, z->getMaxEnemyPod() - z->myPods), departureRate(z->index));
+                _strength[z->index] = PlayerStrength{(float)z->myPods, (float)z->p1, (float)z->p2, (float)z->p3};
+            }
+            propagate();
+        }
         
-        int duration = ((clock() - start ) * 1000 )/ ((double)CLOCKS_PER_SEC);
-        cerr << "Time Game Loop : " << duration  << "ms" << endl;
+        void compute(const Board& b)
+        {
+            for(int z = 0; z < b.zoneCount; z++)
+            {
+                int maxPods = 0;
+                int strongest = 1;
+                for(int s = 1; s < MAX_PLAYERS; s++)
+                {
+                    if(b.pods[s][z] > maxPods)
+                    {
+                        maxPods = b.pods[s][z];
+                        strongest = s;
+                    }
+                }
+                int threat = max(0, maxPods - b.pods[0][z]);
+                setThreat(z, threat, threat > 0 ? departureRate(z, strongest) : 100);
+                for(int s = 0; s < MAX_PLAYERS; s++)
+                {
+                    _strength[z][s] = b.pods[s][z];
+                }
+            }
+            propagate();
+        }
+        
+        //Decayed pods of player 'slot' reaching zone 'z' : 0 is us, 1..3 the enemy slots
+        float getStrength(int z, int slot) const
+        {
+            return _strength[z][slot];
+        }
+        
+        //Strongest enemy reaching zone 'z'
+        float getEnemyStrength(int z) const
+        {
+            const PlayerStrength& strength = _strength[z];
+            return max(strength[1], max(strength[2], strength[3]));
+        }
+    
+    private:
+        vector<PlayerStrength> _strength;   // by zone, see getStrength
+        vector<PlayerStrength> _nextStrength;
+        vector<InfluenceSource> _best;      // strongest threat reaching each zone
+        vector<InfluenceSource> _second;    // strongest one from another zone
+        vector<InfluenceSource> _nextBest;
+        vector<InfluenceSource> _nextSecond;
+        
+        //'rate' : percent of the threat that leaves the zone
+        void setThreat(int z, int threat, int rate)
+        {
+            _best[z] = {threat * rate / 100.0f, threat > 0 && rate > 0 ? z : -1};
+            _second[z] = {0, -1};
+        }
+        
+        //Keep the two strongest sources of distinct zones
+        static void offer(InfluenceSource& best, InfluenceSource& second, InfluenceSource candidate)
+        {
+            if(candidate.zone < 0 || candidate.value <= second.value)
+            {
+                return;
+            }
+            if(candidate.zone == best.zone)
+            {
+                best.value = max(best.value, candidate.value);
+            }
+            else if(candidate.value > best.value)
+            {
+                second = best;
+                best = candidate;
+            }
+            else
+            {
+                second = candidate;
+            }
+        }
+        
+        void propagate()
+        {
+            int n = topology->zoneCount;
+            const int* offsets = topology->offsets.data();
+            const int* neighbours = topology->neighbours.data();
+            for(int hop = 1; hop < INFLUENCE_HOPS; hop++)
+            {
+                for(int z = 0; z < n; z++)
+                {
+                    InfluenceSource best = _best[z];
+                    InfluenceSource second = _second[z];
+                    for(int k = offsets[z]; k < offsets[z + 1]; k++)
+                    {
+                        int l = neighbours[k];
+                        offer(best, second, {_best[l].value * INFLUENCE_DECAY, _best[l].zone});
+                        offer(best, second, {_second[l].value * INFLUENCE_DECAY, _second[l].zone});
+                    }
+                    _nextBest[z] = best;
+                    _nextSecond[z] = second;
+                }
+                _best.swap(_nextBest);
+                _second.swap(_nextSecond);
+            }
+            for(int hop = 1; hop < INFLUENCE_HOPS; hop++)
+            {
+                spreadStrength(n, offsets, neighbours);
+            }
+            
+            for(int z = 0; z < n; z++)
+            {
+                float sum = 0;
+                for(int k = offsets[z]; k < offsets[z + 1]; k++)
+                {
+                    int l = neighbours[k];
+                    sum += _best[l].zone != z ? _best[l].value : _second[l].value;
+                }
+                danger[z] = (int)sum;
+            }
+        }
+        
+        static PlayerStrength maxStrength(PlayerStrength a, PlayerStrength b)
+        {
+            return a > b ? a : b;
+        }
+        
+        //One hop of every player's strength at once, a vector max per link
+        void spreadStrength(int n, const int* offsets, const int* neighbours)
+        {
+            const PlayerStrength* in = _strength.data();
+            PlayerStrength* out = _nextStrength.data();
+            for(int z = 0; z < n; z++)
+            {
+                PlayerStrength reach = {};
+                for(int k = offsets[z]; k < offsets[z + 1]; k++)
+                {
+                    reach = maxStrength(reach, in[neighbours[k]]);
+                }
+                out[z] = maxStrength(in[z], reach * INFLUENCE_DECAY);
+            }
+            _strength.swap(_nextStrength);
+        }
+};
+
+/** MOBILITY **/
+/*
+  Last MOBILITY_HISTORY departure rates (percent) of an opponent, on a zone or over whole turns.
+*/
+struct MobilityRing {
+    unsigned char samples[MOBILITY_HISTORY];
+    unsigned char next;
+    unsigned char count;
+    short sum;
+    
+    void push(int rate)
+    {
+        if(count == MOBILITY_HISTORY)
+        {
+            sum -= samples[next];
+        }
+        else
+        {
+            count++;
+        }
+        samples[next] = rate;
+        sum += rate;
+        next = (next + 1) % MOBILITY_HISTORY;
+    }
+};
+
+/*
+  Per opponent movement model, learnt from the pods counts of consecutive turns.
+  A zone that held pods of an opponent tells how many of them left : before - after, when positive.
+  Pods lost in fights are counted as departures, which keeps the model on the safe side.
+  Rates are kept per zone, and over whole turns as a prior for the zones seldom seen.
+  predict() gives each zone holding enemy pods the rate of its strongest enemy : the influence
+  map weights the threat the zone spreads with it, over every hop.
+  Rates start at 100%, where the danger matches the historical podDanger.
+  Only zones holding enemy pods are visited, by update() as by predict().
+*/
+class MobilityModel {
+    public:
+        vector<int> departure;              // percent of the strongest enemy leaving each zone next turn
+        
+        MobilityModel(int zoneCount)
+        {
+            MobilityRing empty = {};
+            for(int s = 0; s < MAX_PLAYERS - 1; s++)
+            {
+                _zones[s].assign(zoneCount, empty);
+                _turns[s] = empty;
+            }
+            departure.assign(zoneCount, 100);
+            updateMicros = 0;
+            queryMicros = 0;
+        }
+        
+        //Pods count of enemy 'slot' (1..3) on 'zone', last turn and this turn
+        void observe(int zone, int slot, int before, int after)
+        {
+            if(before > 0)
+            {
+                _observations.push_back({zone, slot, before, after});
+            }
+        }
+        
+        //Push this turn's observations
+        void update()
+        {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            int left[MAX_PLAYERS - 1] = {};
+            int seen[MAX_PLAYERS - 1] = {};
+            for(const Observation& o : _observations)
+            {
+                int departures = max(0, o.before - o.after);
+                _zones[o.slot - 1][o.zone].push(departures * 100 / o.before);
+                left[o.slot - 1] += departures;
+                seen[o.slot - 1] += o.before;
+            }
+            for(int s = 0; s < MAX_PLAYERS - 1; s++)
+            {
+                if(seen[s] > 0)
+                {
+                    _turns[s].push(left[s] * 100 / seen[s]);
+                }
+            }
+            _observations.clear();
+            updateMicros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        }
+        
+        //Departure rate of enemy 'slot' on 'zone', percent
+        int getRate(int slot, int zone)
+        {
+            const MobilityRing& turns = _turns[slot - 1];
+            int prior = turns.count > 0 ? turns.sum / turns.count : 100;
+            const MobilityRing& ring = _zones[slot - 1][zone];
+            return (ring.sum + prior * MOBILITY_PRIOR_WEIGHT) / (ring.count + MOBILITY_PRIOR_WEIGHT);
+        }
+        
+        //Departure rate of every zone holding enemy pods for the next turn, 100 elsewhere
+        void predict()
+        {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for(int z : _touched)
+            {
+                departure[z] = 100;
+            }
+            _touched.clear();
+            for(Zone* z : zones)
+            {
+                int maxPods = z->getMaxEnemyPod();
+                if(maxPods == 0)
+                {
+                    continue;
+                }
+                int strongest = z->p1 == maxPods ? 1 : z->p2 == maxPods ? 2 : 3;
+                departure[z->index] = getRate(strongest, z->index);
+                _touched.push_back(z->index);
+            }
+            queryMicros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        }
+        
+        //Most likely enemy moves applied to 'b' : the expected leavers of each zone head to
+        //the richest neighbour they do not own yet, lowest index first
+        void predictMoves(Board& b)
+        {
+            Board before = b;
+            for(int s = 1; s < MAX_PLAYERS; s++)
+            {
+                for(int z = 0; z < b.zoneCount; z++)
+                {
+                    if(before.pods[s][z] == 0)
+                    {
+                        continue;
+                    }
+                    int leaving = (before.pods[s][z] * getRate(s, z) + 50) / 100;
+                    int destination = -1;
+                    for(int i = topology->offsets[z]; i < topology->offsets[z + 1]; i++)
+                    {
+                        int l = topology->neighbours[i];
+                        if(before.owner[l] != s && (destination == -1 || topology->platinum[l] > topology->platinum[destination]
+                            || (topology->platinum[l] == topology->platinum[destination] && l < destination)))
+                        {
+                            destination = l;
+                        }
+                    }
+                    if(leaving > 0 && destination != -1)
+                    {
+                        b.applyMove(s, leaving, z, destination);
+                    }
+                }
+            }
+        }
+        
+        void report()
+        {
+            cerr << "Mobility : update " << updateMicros << "us, predict " << queryMicros << "us, rates";
+            for(int s = 0; s < MAX_PLAYERS - 1; s++)
+            {
+                if(_turns[s].count > 0)
+                {
+                    cerr << " p" << s + 1 << " " << _turns[s].sum / _turns[s].count << "%";
+                }
+            }
+            cerr << endl;
+        }
+        
+        long long updateMicros;
+        long long queryMicros;
+    
+    private:
+        struct Observation {
+            int zone;
+            int slot;
+            int before;
+            int after;
+        };
+        vector<MobilityRing> _zones[MAX_PLAYERS - 1];
+        MobilityRing _turns[MAX_PLAYERS - 1];
+        vector<Observation> _observations;
+        vector<int> _touched;               // zones whose departure was set
+};
+
+//Departure rate of the strongest enemy on 'zone', as predicted for this turn
+int departureRate(int zone)
+{
+    return MOBILITY_MODEL ? mobility->departure[zone] : 100;
+}
+
+//Departure rate of enemy 'slot' on 'zone', for boards other than the current one
+int departureRate(int zone, int slot)
+{
+    return MOBILITY_MODEL ? mobility->getRate(slot, zone) : 100;
+}
+
+/** FRONTIER **/
+/*
+  Distance from each zone to the nearest zone we do not own, on its continent.
+  Zones we do not own are at distance 0, zones of a continent we fully own at FRONTIER_UNREACHABLE.
+  Ownership changes are repaired in place :
+  - zones we won, and the zones whose distance only came through them, are invalidated
+  - invalidated zones restart from their valid neighbours, zones we lost restart from 0,
+    and a breadth first pass lowers the distances around them
+*/
+class FrontierField {
+    public:
+        vector<int> distance;
+        
+        FrontierField(int zoneCount)
+        {
+            distance.assign(zoneCount, 0);          // nothing is owned before the first turn
+            _invalid.assign(zoneCount, false);
+        }
+        
+        //'won' and 'lost' are the indexes of the zones whose ownership by us changed
+        void update(const vector<int>& won, const vector<int>& lost)
+        {
+            const IntView& offsets = topology->offsets;
+            const IntView& neighbours = topology->neighbours;
+            
+            //Invalidate the won zones and the zones depending on them
+            _raised.clear();
+            for(int z : won)
+            {
+                _invalid[z] = true;
+                _raised.push_back(z);
+            }
+            for(size_t i = 0; i < _raised.size(); i++)
+            {
+                int u = _raised[i];
+                for(int k = offsets[u]; k < offsets[u + 1]; k++)
+                {
+                    int v = neighbours[k];
+                    if(_invalid[v] || distance[v] != distance[u] + 1 || isSupported(v))
+                    {
+                        continue;
+                    }
+                    _invalid[v] = true;
+                    _raised.push_back(v);
+                }
+            }
+            
+            //Restart the invalid zones from their valid neighbours
+            for(int z : _raised)
+            {
+                distance[z] = FRONTIER_UNREACHABLE;
+            }
+            _seeds.clear();
+            for(int z : _raised)
+            {
+                for(int k = offsets[z]; k < offsets[z + 1]; k++)
+                {
+                    int n = neighbours[k];
+                    if(!_invalid[n] && distance[n] != FRONTIER_UNREACHABLE)
+                    {
+                        distance[z] = min(distance[z], distance[n] + 1);
+                    }
+                }
+                if(distance[z] != FRONTIER_UNREACHABLE)
+                {
+                    _seeds.push_back({distance[z], z});
+                }
+            }
+            for(int z : _raised)
+            {
+                _invalid[z] = false;
+            }
+            for(int z : lost)
+            {
+                distance[z] = 0;
+                _seeds.push_back({0, z});
+            }
+            
+            //Breadth first from the seeds, taken by increasing distance
+            sort(_seeds.begin(), _seeds.end());
+            _queue.clear();
+            size_t seed = 0;
+            size_t head = 0;
+            while(seed < _seeds.size() || head < _queue.size())
+            {
+                int u;
+                if(head == _queue.size() || (seed < _seeds.size() && _seeds[seed].first <= distance[_queue[head]]))
+                {
+                    u = _seeds[seed++].second;
+                }
+                else
+                {
+                    u = _queue[head++];
+                }
+                for(int k = offsets[u]; k < offsets[u + 1]; k++)
+                {
+                    int v = neighbours[k];
+                    if(distance[v] > distance[u] + 1)
+                    {
+                        distance[v] = distance[u] + 1;
+                        _queue.push_back(v);
+                    }
+                }
+            }
+        }
+    
+    private:
+        vector<bool> _invalid;
+        vector<int> _raised;
+        vector<pair<int, int> > _seeds;
+        vector<int> _queue;
+        
+        //A zone keeps its distance if a valid neighbour is one step closer to the frontier
+        bool isSupported(int z)
+        {
+            for(int k = topology->offsets[z]; k < topology->offsets[z + 1]; k++)
+            {
+                int n = topology->neighbours[k];
+                if(!_invalid[n] && distance[n] == distance[z] - 1)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+};
+
+int frontierDistance(Zone* z)
+{
+    return frontier->distance[z->index];
+}
+
+/** LANDMARKS **/
+/*
+  Point to point routes with A* and the ALT heuristic.
+  Each continent gets ALT_LANDMARKS landmarks, picked farthest first, and their
+  breadth first distances to every zone of the continent. By the triangle inequality,
+  max over landmarks of |d(l, a) - d(l, b)| never exceeds d(a, b), so routes are exact.
+  Search state is stamped by query and the open set is a reused heap : a query allocates nothing.
+*/
+class LandmarkRouter {
+    public:
+        LandmarkRouter()
+        {
+            int n = topology->zoneCount;
+            for(int k = 0; k < ALT_LANDMARKS; k++)
+            {
+                _landmark[k].assign(n, 0);
+            }
+            _cost.assign(n, 0);
+            _parent.assign(n, -1);
+            _seen.assign(n, 0);
+            _search = 0;
+            
+            //Farthest first : each landmark maximises its distance to the previous ones
+            vector<int> nearest(n, MAX_BOARD_DISTANCE);
+            vector<int> queue;
+            for(int c = 0; c + 1 < topology->continentOffsets.size(); c++)
+            {
+                int first = topology->continentOffsets[c];
+                int last = topology->continentOffsets[c + 1];
+                int next = first;
+                for(int k = 0; k < ALT_LANDMARKS; k++)
+                {
+                    spread(next, _landmark[k], queue);
+                    for(int z = first; z < last; z++)
+                    {
+                        nearest[z] = min(nearest[z], _landmark[k][z]);
+                    }
+                    //Argmax once every distance is updated, the landmark itself is now at 0
+                    for(int z = first; z < last; z++)
+                    {
+                        if(nearest[z] > nearest[next])
+                        {
+                            next = z;
+                        }
+                    }
+                }
+            }
+        }
+        
+        //Exact distance from 'from' to 'to', -1 on another continent ; 'path' gets the zones after 'from'
+        int route(int from, int to, vector<Zone*>& path)
+        {
+            path.clear();
+            if(topology->continentOf[from] != topology->continentOf[to])
+            {
+                return -1;
+            }
+            turnCounters.routeCalls++;
+            _search++;
+            _heap.clear();
+            visit(from, 0, -1, to);
+            while(!_heap.empty())
+            {
+                pop_heap(_heap.begin(), _heap.end(), isWorse);
+                OpenZone open = _heap.back();
+                int z = open.zone;
+                _heap.pop_back();
+                if(open.cost > _cost[z])
+                {
+                    continue;
+                }
+                if(z == to)
+                {
+                    break;
+                }
+                turnCounters.routeExpanded++;
+                for(int k = topology->offsets[z]; k < topology->offsets[z + 1]; k++)
+                {
+                    visit(topology->neighbours[k], _cost[z] + 1, z, to);
+                }
+            }
+            for(int z = to; z != from; z = _parent[z])
+            {
+                path.push_back(zones[z]);
+            }
+            reverse(path.begin(), path.end());
+            return _cost[to];
+        }
+        
+        int heuristic(int a, int b)
+        {
+            int best = 0;
+            for(int k = 0; k < ALT_LANDMARKS; k++)
+            {
+                best = max(best, abs(_landmark[k][a] - _landmark[k][b]));
+            }
+            return best;
+        }
+    
+    private:
+        vector<int> _landmark[ALT_LANDMARKS];  // distance of each zone to the k-th landmark of its continent
+        vector<int> _cost;
+        vector<int> _parent;
+        vector<int> _seen;                  // search which last reached each zone
+        int _search;
+        struct OpenZone {
+            int estimate;                   // cost + heuristic
+            int cost;
+            int zone;
+        };
+        vector<OpenZone> _heap;
+        
+        //Lowest estimate first, then deepest : on ties the search goes straight to the goal
+        static bool isWorse(const OpenZone& a, const OpenZone& b)
+        {
+            return a.estimate != b.estimate ? a.estimate > b.estimate : a.cost < b.cost;
+        }
+        
+        void visit(int z, int cost, int parent, int to)
+        {
+            if(_seen[z] == _search && _cost[z] <= cost)
+            {
+                return;
+            }
+            _seen[z] = _search;
+            _cost[z] = cost;
+            _parent[z] = parent;
+            _heap.push_back({cost + heuristic(z, to), cost, z});
+            push_heap(_heap.begin(), _heap.end(), isWorse);
+        }
+        
+        //Breadth first distances from 'origin' over its continent
+        void spread(int origin, vector<int>& distance, vector<int>& queue)
+        {
+            int first = topology->continentOffsets[topology->continentOf[origin]];
+            int last = topology->continentOffsets[topology->continentOf[origin] + 1];
+            for(int z = first; z < last; z++)
+            {
+                distance[z] = -1;
+            }
+            queue.clear();
+            queue.push_back(origin);
+            distance[origin] = 0;
+            for(size_t i = 0; i < queue.size(); i++)
+            {
+                int z = queue[i];
+                for(int k = topology->offsets[z]; k < topology->offsets[z + 1]; k++)
+                {
+                    int n = topology->neighbours[k];
+                    if(distance[n] == -1)
+                    {
+                        distance[n] = distance[z] + 1;
+                        queue.push_back(n);
+                    }
+                }
+            }
+        }
+};
+
+int routeTo(Zone* from, Zone* to, vector<Zone*>& path)
+{
+    return router->route(from->index, to->index, path);
+}
+
+/***********************************************************************************************************
+
+/** PATH FINTDING **/
+/*
+  Path finding with closure
+  When the closure is a mood's catcher, the mood is given too, and the search is bounded :
+  each zone has a lower bound of its distance to a target, the cluster hops to the nearest
+  cluster holding one and, when the mood only seeks zones we do not own, its frontier distance.
+  A zone is left out when its depth plus this bound exceeds the search bound. The first bound
+  is the origin's own, so the search follows the gradient of the frontier field toward the
+  nearest frontier zones instead of flooding our territory, and the bound doubles while no
+  target is caught, up to 'maxDistance'. The parents of a zone kept are kept too, so the
+  zones met, their order and their ancestors are those of the full search.
+  Each depth lists a zone once, ordered by its last parent, which is also its ancestor :
+  the last zone caught at the first depth with a catch is the target, as when a zone was
+  listed again for each of its parents, without the listing growing with the paths count.
+  Zones farther than 'maxDistance' are not explored.
+*/
+ZoneIntend* pathFinding(Zone* origin, function<bool (Zone*)> func, Mood* mood, int maxDistance)
+{
+    thread_local int search = 0;
+    ZoneIntend* result = new ZoneIntend();
+    
+    bool prunes = mood != nullptr && exactShortcuts;
+    bool seeksForeign = prunes && mood->seeksForeignZones();
+    const vector<int>* clusterDistance = prunes ? &origin->continent->getClusterDistances(mood) : nullptr;
+    auto lowerBound = [&] (Zone* z) {
+        return max((*clusterDistance)[z->cluster->index], seeksForeign ? frontierDistance(z) : 0);
+    };
+    int bound = prunes ? lowerBound(origin) : maxDistance;
+    if(bound > maxDistance)
+    {
+        return result;
+    }
+    
+    turnCounters.bfsCalls++;
+    vector<Zone*> whiteList;
+    vector<Zone*> tempList;
+    while(true)
+    {
+        search++;
+        whiteList.clear();
+        
+        //Check the war case, unit cannot flee on ennemy zones.
+        if(origin->hasEnemyPodOnIt())
+        {
+            for(Zone* z : origin->links())
+            {
+                if(z->isHostil())
+                {
+                    z->visited = search;
+                }
+            }
+        }
+        
+        origin->visited = search;
+        origin->ancestor = origin;
+        whiteList.push_back(origin);
+        
+        //The origin and its neighbours are both at distance 1
+        for(int depth = 0; result->zone == nullptr && whiteList.size() != 0 && depth <= bound; depth++)
+        {
+            //cerr << "WhiteList " << whiteList.size() << endl;
+            Zone* caught = nullptr;
+            for(Zone* z : whiteList)
+            {
+                if(mood == nullptr ? func(z) : (!prunes || lowerBound(z) == 0) && mood->catches(z))
+                {
+                    caught = z;
+                }
+            }
+            if(caught != nullptr)
+            {
+                Zone* z = caught;
+                result->zone = z;
+                result->distance = 1;
+                result->path.assign(1, z);
+                
+                while(z->ancestor != origin)
+                {
+                    z = z->ancestor;
+                    result->distance++;
+                    result->zone = z;
+                    result->path.push_back(z);
+                }
+                reverse(result->path.begin(), result->path.end());
+            }
+            else if(depth < bound)
+            {
+                //Backward, so a zone is listed once, ordered by its last parent which is its ancestor
+                for(int i = whiteList.size() - 1; i >= 0; i--)
+                {
+                    Zone* z = whiteList[i];
+                    turnCounters.bfsExpanded++;
+                    for(int k = z->linkCount - 1; k >= 0; k--)
+                    {
+                        Zone* neighbour = zonesById[z->neighbours[k]];
+                        if(neighbour->visited != search && (!prunes || depth + 1 + lowerBound(neighbour) <= bound))
+                        {
+                            neighbour->visited = search;
+                            neighbour->ancestor = z;
+                            tempList.push_back(neighbour);
+                        }
+                    }
+                }
+                reverse(tempList.begin(), tempList.end());
+            }
+            whiteList.swap(tempList);
+            tempList.clear();
+        }
+        if(result->zone != nullptr || bound >= maxDistance)
+        {
+            return result;
+        }
+        bound = min(maxDistance, bound + max(1, bound));
+    }
+}
+
+/** COMMANDS **/
+struct Move {
+    int podsCount;
+    Zone* zoneOrigin;
+    Zone* zoneDestination;
+};
+
+void addMove(int podsCount, Zone* zoneOrigin, Zone* zoneDestination)
+{
+    Move m;
+    m.podsCount = podsCount;
+    m.zoneOrigin = zoneOrigin;
+    m.zoneDestination = zoneDestination;
+    zoneOrigin->addIntend(-1);
+    zoneDestination->addIntend(1);
+    
+    if(moves.size() == moves.capacity())
+    {
+        turnCounters.moveAllocations++;
+    }
+    moves.push_back(m);
+}
+
+struct Create {
+    int podsCount;
+    Zone* zoneDestination;
+};
+
+void addCreate(int podsCount, Zone* zoneDestination)
+{
+    Create c;
+    c.podsCount = podsCount;
+    c.zoneDestination = zoneDestination;
+    zoneDestination->addIntend(podsCount);
+    zoneDestination->continent->intends += podsCount;
+    
+    if(creates.size() == creates.capacity())
+    {
+        turnCounters.createAllocations++;
+    }
+    creates.push_back(c);
+}
+
+/** WORKERS **/
+/*
+  Persistent pool for the parallel part of a turn : the planner rollouts.
+  One thread per extra core, pinned to it, each with its own deque of tasks.
+  A worker pops the front of its deque, and steals the back of the others' when it is empty.
+  The calling thread steals too until the batch is done, and runs it alone when the pool
+  has no worker.
+  A small turn costs more to dispatch than to compute : calibrate() times an empty batch
+  and breadth first sweeps of the map. Turns whose estimated work, in zone expansions,
+  is below 'threshold' run inline.
+*/
+class WorkerPool {
+    public:
+        int threshold;                      // estimated work from which a turn fans out
+        double dispatchMicros;              // round trip of an empty batch
+        double zoneMicros;                  // one zone expansion
+        
+        WorkerPool(int threadCount)
+        {
+            threshold = INT_MAX;
+            dispatchMicros = 0;
+            zoneMicros = 0;
+            _queued = 0;
+            _pending = 0;
+            _stopping = false;
+            int cores = max(1, (int)thread::hardware_concurrency());
+            for(int i = 0; i + 1 < threadCount; i++)
+            {
+                _workers.push_back(new Worker());
+            }
+            for(size_t i = 0; i < _workers.size(); i++)
+            {
+                Worker* w = _workers[i];
+                w->worker = thread(&WorkerPool::work, this, i);
+                cpu_set_t cpus;
+                CPU_ZERO(&cpus);
+                CPU_SET((i + 1) % cores, &cpus);
+                pthread_setaffinity_np(w->worker.native_handle(), sizeof(cpu_set_t), &cpus);
+            }
+        }
+        
+        //Wakes the workers up to stop them, no batch may be running
+        ~WorkerPool()
+        {
+            {
+                lock_guard<mutex> lock(_sleepLock);
+                _stopping = true;
+            }
+            _wake.notify_all();
+            for(Worker* w : _workers)
+            {
+                w->worker.join();
+                delete w;
+            }
+        }
+        
+        int getThreadCount()
+        {
+            return _workers.size() + 1;
+        }
+        
+        //Run every task, spread over the deques, and wait for them
+        void run(vector<function<void()> >& tasks)
+        {
+            if(tasks.empty())
+            {
+                return;
+            }
+            if(_workers.empty())
+            {
+                for(function<void()>& task : tasks)
+                {
+                    task();
+                }
+                return;
+            }
+            _pending = tasks.size();
+            for(size_t i = 0; i < tasks.size(); i++)
+            {
+                Worker* w = _workers[i % _workers.size()];
+                lock_guard<mutex> lock(w->lock);
+                w->tasks.push_back(&tasks[i]);
+            }
+            {
+                lock_guard<mutex> lock(_sleepLock);
+                _queued += tasks.size();
+            }
+            _wake.notify_all();
+            
+            function<void()>* task;
+            while(pop(-1, task))
+            {
+                execute(task);
+            }
+            unique_lock<mutex> lock(_sleepLock);
+            _done.wait(lock, [this] { return _pending == 0; });
+        }
+        
+        //Threshold where dispatching costs as much as the work it spreads
+        void calibrate()
+        {
+            if(_workers.empty() || topology->zoneCount == 0)
+            {
+                return;
+            }
+            const int rounds = 32;
+            vector<function<void()> > empty(getThreadCount(), [] () {});
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for(int r = 0; r < rounds; r++)
+            {
+                run(empty);
+            }
+            dispatchMicros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / rounds;
+            
+            int n = topology->zoneCount;
+            vector<int> seen(n, -1);
+            vector<int> queue;
+            long long expanded = 0;
+            start = chrono::steady_clock::now();
+            for(int origin = 0; origin < n && expanded < 100000; origin += max(1, n / rounds))
+            {
+                queue.assign(1, origin);
+                seen[origin] = origin;
+                for(size_t i = 0; i < queue.size(); i++)
+                {
+                    int z = queue[i];
+                    for(int k = topology->offsets[z]; k < topology->offsets[z + 1]; k++)
+                    {
+                        int l = topology->neighbours[k];
+                        if(seen[l] != origin)
+                        {
+                            seen[l] = origin;
+                            queue.push_back(l);
+                        }
+                    }
+                }
+                expanded += queue.size();
+            }
+            zoneMicros = max(1e-6, chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / max(1LL, expanded));
+            threshold = (int)min<double>(INT_MAX, dispatchMicros / zoneMicros);
+            cerr << "Workers : " << getThreadCount() << " threads, dispatch " << dispatchMicros << "us, zone " << zoneMicros * 1000 << "ns, threshold " << threshold << endl;
+        }
+    
+    private:
+        struct Worker {
+            mutex lock;
+            deque<function<void()>*> tasks;
+            thread worker;
+        };
+        
+        vector<Worker*> _workers;
+        mutex _sleepLock;
+        condition_variable _wake;           // tasks were queued
+        condition_variable _done;           // the batch is over
+        atomic<int> _queued;                // tasks in the deques
+        atomic<int> _pending;               // tasks of the batch not done yet
+        bool _stopping;                     // the pool is destroyed, guarded by _sleepLock
+        
+        //Front of its own deque, else the back of another ; 'self' is -1 for the caller
+        bool pop(int self, function<void()>*& task)
+        {
+            if(self >= 0 && popFrom(self, true, task))
+            {
+                return true;
+            }
+            for(size_t i = 1; i <= _workers.size(); i++)
+            {
+                int victim = (self + i + _workers.size()) % _workers.size();
+                if(victim != self && popFrom(victim, false, task))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+        
+        bool popFrom(int index, bool front, function<void()>*& task)
+        {
+            Worker* w = _workers[index];
+            lock_guard<mutex> lock(w->lock);
+            if(w->tasks.empty())
+            {
+                return false;
+            }
+            if(front)
+            {
+                task = w->tasks.front();
+                w->tasks.pop_front();
+            }
+            else
+            {
+                task = w->tasks.back();
+                w->tasks.pop_back();
+            }
+            _queued--;
+            return true;
+        }
+        
+        void execute(function<void()>* task)
+        {
+            (*task)();
+            if(--_pending == 0)
+            {
+                lock_guard<mutex> lock(_sleepLock);
+                _done.notify_all();
+            }
+        }
+        
+        void work(int self)
+        {
+            while(true)
+            {
+                function<void()>* task;
+                if(pop(self, task))
+                {
+                    execute(task);
+                    continue;
+                }
+                unique_lock<mutex> lock(_sleepLock);
+                _wake.wait(lock, [this] { return _queued > 0 || _stopping; });
+                if(_stopping)
+                {
+                    return;
+                }
+            }
+        }
+};
+
+/** PLANNER **/
+/*
+  Rollout planner.
+  For each contested zone (on war or about to loose supremacy), a few plans are built :
+  - hold : nothing moves
+  - retreat : our pods leave to a safe neighbour
+  - reinforce : pods of the neighbourhood join the zone, greedy or sampled
+  Every plan is played on board forks against random enemies for PLANNER_DEPTH turns,
+  the best average outcome around the zone wins.
+  Plans of a zone are played BATCH_LANES at a time, one lane of a BatchBoard each.
+  Rollouts are swept until the time budget is spent, on the worker pool when the turn is heavy.
+*/
+struct PlanMove {
+    int podsCount;
+    int from;
+    int to;
+};
+
+struct Plan {
+    int zone;                   // contested zone
+    vector<PlanMove> moves;     // our moves for the first turn
+    vector<int> region;         // zones scored by the rollouts
+    long long score;            // sum of rollouts scores
+    int rollouts;               // rollouts played
+};
+
+/*
+  xorshift generator, one per planner thread
+*/
+struct Random {
+    unsigned long long state;
+    
+    Random(unsigned long long seed)
+    {
+        state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    }
+    
+    unsigned int next()
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return (unsigned int)(state >> 32);
+    }
+    
+    int range(int n)
+    {
+        return next() % n;
+    }
+};
+
+//Zones within 'radius' hops of 'origin'
+vector<int> planRegion(int origin, int radius)
+{
+    vector<int> region;
+    vector<int> depth(topology->zoneCount, -1);
+    region.push_back(origin);
+    depth[origin] = 0;
+    for(size_t i = 0; i < region.size(); i++)
+    {
+        int z = region[i];
+        if(depth[z] == radius)
+        {
+            continue;
+        }
+        for(int k = topology->offsets[z]; k < topology->offsets[z + 1]; k++)
+        {
+            int n = topology->neighbours[k];
+            if(depth[n] == -1)
+            {
+                depth[n] = depth[z] + 1;
+                region.push_back(n);
+            }
+        }
+    }
+    return region;
+}
+
+//Our outcome on the region of a plan, for every lane
+void scoreRegion(const BatchBoard& b, const vector<int>& region, BatchLanes& score)
+{
+    score = BatchLanes{};
+    for(int z : region)
+    {
+        int zoneScore = PLANNER_ZONE_SCORE + PLANNER_PLATINUM_SCORE * topology->platinum[z];
+        score += (b.owner[z] == 0) & zoneScore;
+        score -= (b.owner[z] > 0) & zoneScore;
+        score += PLANNER_POD_SCORE * b.pods[0][z];
+        for(int s = 1; s < MAX_PLAYERS; s++)
+        {
+            score -= PLANNER_POD_SCORE * b.pods[s][z];
+        }
+    }
+}
+
+/*
+  Play 'count' plans of the same zone, starting at 'first', one lane each :
+  enemies wander randomly in the region, we hold after the first turn.
+  Each enemy pod moves at most once a turn, from where it stood when the turn started,
+  and a move that would leave the region is not played : scored pods never vanish.
+  'area' is the region and its border, where the pods of a plan can come from.
+*/
+void rollout(const Board& origin, const vector<Plan>& plans, int first, int count, const vector<int>& area, Random& random, int* scores)
+{
+    BatchBoard b;
+    b.load(origin, area);
+    for(int lane = 0; lane < count; lane++)
+    {
+        for(const PlanMove& m : plans[first + lane].moves)
+        {
+            b.applyMove(lane, 0, m.podsCount, m.from, m.to);
+        }
+    }
+    const vector<int>& region = plans[first].region;
+    bool inRegion[MAX_BOARD_ZONES] = {};
+    for(int z : region)
+    {
+        inRegion[z] = true;
+    }
+    vector<BatchLanes> standing(region.size() * (MAX_PLAYERS - 1));
+    for(int turn = 0; turn < PLANNER_DEPTH; turn++)
+    {
+        for(size_t r = 0; r < region.size(); r++)
+        {
+            for(int s = 1; s < MAX_PLAYERS; s++)
+            {
+                standing[r * (MAX_PLAYERS - 1) + s - 1] = b.pods[s][region[r]];
+            }
+        }
+        for(size_t r = 0; r < region.size(); r++)
+        {
+            int z = region[r];
+            int firstLink = topology->offsets[z];
+            int degree = topology->offsets[z + 1] - firstLink;
+            if(degree == 0)
+            {
+                continue;
+            }
+            for(int lane = 0; lane < count; lane++)
+            {
+                for(int s = 1; s < MAX_PLAYERS; s++)
+                {
+                    for(int pod = standing[r * (MAX_PLAYERS - 1) + s - 1][lane]; pod > 0; pod--)
+                    {
+                        if(random.next() & 1)
+                        {
+                            int to = topology->neighbours[firstLink + random.range(degree)];
+                            if(inRegion[to])
+                            {
+                                b.applyMove(lane, s, 1, z, to);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        b.resolveFights(region);
+    }
+    BatchLanes score;
+    scoreRegion(b, region, score);
+    for(int lane = 0; lane < count; lane++)
+    {
+        scores[lane] = score[lane];
+    }
+}
+
+//Candidate plans for a contested zone ; 'reserved' are our pods already used by another plan
+vector<Plan> buildPlans(const Board& board, Zone* z, const vector<int>& reserved, Random& random)
+{
+    vector<Plan> plans;
+    Plan hold;
+    hold.zone = z->index;
+    hold.region = planRegion(z->index, PLANNER_RADIUS);
+    hold.score = 0;
+    hold.rollouts = 0;
+    plans.push_back(hold);
+    
+    int onZone = board.pods[0][z->index] - reserved[z->index];
+    vector<PlanMove> sources;
+    for(Zone* l : z->links())
+    {
+        if(onZone > 0 && !l->isHostil())
+        {
+            Plan retreat = hold;
+            retreat.moves.push_back({onZone, z->index, l->index});
+            plans.push_back(retreat);
+        }
+        int available = board.pods[0][l->index] - reserved[l->index];
+        if(available > 0)
+        {
+            sources.push_back({available, l->index, z->index});
+        }
+    }
+    if(sources.empty())
+    {
+        return plans;
+    }
+    
+    //Greedy reinforcements, biggest stacks first
+    stable_sort(sources.begin(), sources.end(), [] (const PlanMove& a, const PlanMove& b) { return a.podsCount > b.podsCount;});
+    for(int count = 1; count <= PLANNER_MAX_REINFORCE; count++)
+    {
+        Plan reinforce = hold;
+        int left = count;
+        for(const PlanMove& source : sources)
+        {
+            int taken = min(left, source.podsCount);
+            if(taken > 0)
+            {
+                reinforce.moves.push_back({taken, source.from, source.to});
+                left -= taken;
+            }
+        }
+        if(left > 0)
+        {
+            break;
+        }
+        plans.push_back(reinforce);
+    }
+    
+    //Sampled reinforcements
+    for(int i = 0; i < PLANNER_RANDOM_PLANS; i++)
+    {
+        Plan reinforce = hold;
+        for(const PlanMove& source : sources)
+        {
+            int taken = random.range(source.podsCount + 1);
+            if(taken > 0)
+            {
+                reinforce.moves.push_back({taken, source.from, source.to});
+            }
+        }
+        if(!reinforce.moves.empty())
+        {
+            plans.push_back(reinforce);
+        }
+    }
+    return plans;
+}
+
+//Hand the moves of a plan to the pods standing on its zones
+void commitPlan(const Plan& plan, vector<int>& reserved)
+{
+    vector<int> moving(topology->zoneCount, 0);
+    for(const PlanMove& m : plan.moves)
+    {
+        reserved[m.from] += m.podsCount;
+    }
+    for(Pod* p : pods)
+    {
+        if(p->planned)
+        {
+            continue;
+        }
+        int from = p->currentZone->index;
+        for(const PlanMove& m : plan.moves)
+        {
+            if(m.from == from && moving[from] < m.podsCount)
+            {
+                moving[from]++;
+                p->dropPlan();
+                p->planned = true;
+                p->intend = zones[m.to];
+                p->move(zones[m.to]);
+                break;
+            }
+        }
+        //Holding pods stay on the contested zone
+        if(!p->planned && from == plan.zone && reserved[from] < p->currentZone->myPods)
+        {
+            reserved[from]++;
+            p->dropPlan();
+            p->planned = true;
+            p->intend = p->currentZone;
+        }
+    }
+}
+
+void planContestedZones()
+{
+    if(!Board::canCapture())
+    {
+        return;
+    }
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(PLANNER_TIME_BUDGET_MS);
+    
+    vector<Zone*> contested;
+    for(Zone* z : zonesById)
+    {
+        if(z->continent->isIgnored() || !(z->isOnWar() || z->willLooseSupremacy()))
+        {
+            continue;
+        }
+        bool hasPodAround = z->hasFriendOnIt();
+        for(Zone* l : z->links())
+        {
+            hasPodAround = hasPodAround || l->hasFriendOnIt();
+        }
+        if(hasPodAround)
+        {
+            contested.push_back(z);
+        }
+    }
+    stable_sort(contested.begin(), contested.end(), Overmind::platinumCompareLess);
+    if(contested.size() > PLANNER_MAX_ZONES)
+    {
+        contested.resize(PLANNER_MAX_ZONES);
+    }
+    if(contested.empty())
+    {
+        return;
+    }
+    
+    Board board = Board::capture();
+    Random random(overmind->platinum + contested.size());
+    vector<int> noReservation(topology->zoneCount, 0);
+    vector<Plan> plans;
+    vector<int> firstPlan;
+    vector<vector<int> > areas;
+    for(Zone* z : contested)
+    {
+        firstPlan.push_back(plans.size());
+        areas.push_back(planRegion(z->index, PLANNER_RADIUS + 1));
+        vector<Plan> zonePlans = buildPlans(board, z, noReservation, random);
+        plans.insert(plans.end(), zonePlans.begin(), zonePlans.end());
+    }
+    firstPlan.push_back(plans.size());
+    
+    //Rollouts, one task per batch of plans, swept until the deadline
+    //Heavy turns spread the tasks over the worker pool, light turns and server games run them inline
+    bool pooled = workerPool != nullptr && turnCounters.turnWork >= workerPool->threshold;
+    turnCounters.pooledTurns += pooled;
+    vector<long long> scores(plans.size(), 0);
+    vector<int> counts(plans.size(), 0);
+    BoardTopology* gameTopology = topology;
+    int sweep = 0;
+    vector<function<void()> > tasks;
+    for(size_t c = 0; c < contested.size(); c++)
+    {
+        for(int i = firstPlan[c]; i < firstPlan[c + 1]; i += BATCH_LANES)
+        {
+            tasks.push_back([&, c, i] () {
+                topology = gameTopology;    // globals are per thread
+                Random random((unsigned long long)sweep * plans.size() + i + 1);
+                int laneScores[BATCH_LANES];
+                int count = min(BATCH_LANES, firstPlan[c + 1] - i);
+                rollout(board, plans, i, count, areas[c], random, laneScores);
+                for(int lane = 0; lane < count; lane++)
+                {
+                    scores[i + lane] += laneScores[lane];
+                    counts[i + lane]++;
+                }
+            });
+        }
+    }
+    do
+    {
+        if(pooled)
+        {
+            workerPool->run(tasks);
+        }
+        else
+        {
+            for(function<void()>& task : tasks)
+            {
+                task();
+            }
+        }
+        sweep++;
+    }
+    while(chrono::steady_clock::now() < deadline);
+    for(size_t i = 0; i < plans.size(); i++)
+    {
+        plans[i].score += scores[i];
+        plans[i].rollouts += counts[i];
+    }
+    
+    //Commit the best plan of each zone, when its pods are still free
+    vector<int> reserved(topology->zoneCount, 0);
+    for(size_t c = 0; c < contested.size(); c++)
+    {
+        int best = -1;
+        for(int i = firstPlan[c]; i < firstPlan[c + 1]; i++)
+        {
+            bool isFree = true;
+            for(const PlanMove& m : plans[i].moves)
+            {
+                isFree = isFree && reserved[m.from] + m.podsCount <= board.pods[0][m.from];
+            }
+            if(isFree && (best == -1 || plans[i].score * plans[best].rollouts > plans[best].score * plans[i].rollouts))
+            {
+                best = i;
+            }
+        }
+        if(best != -1)
+        {
+            cerr << "Planner : zone " << contested[c]->id << ", " << plans[best].moves.size() << " moves, score " << plans[best].score / max(1, plans[best].rollouts) << ", rollouts " << plans[best].rollouts << endl;
+            commitPlan(plans[best], reserved);
+        }
+    }
+}
+
+#ifdef __cpp_impl_coroutine
+/** COOPERATIVE PLANNING **/
+/*
+  Pod planning as C++20 coroutines, compiled when the compiler supports them.
+  A PlanTask runs Pod::update one mood at a time : it suspends after each mood,
+  that is after at most one bounded path finding.
+  The PlanScheduler resumes the task of highest priority until every task is done or the
+  deadline is reached, and can be run again later. cancel() destroys the tasks left :
+  a pod cut among its moods still moves to the best intend found so far, a pod never
+  started still fights or follows its path.
+  Without coroutines (before C++20), updatePods runs Pod::update in a plain loop with the
+  same deadline, checked between pods.
+  Priorities follow the pods list : pods see the moves of the pods before them,
+  so a run that is not cut decides exactly as Pod::update does.
+*/
+struct PlanTask {
+    struct promise_type {
+        bool started = false;           // startUpdate() was called
+        
+        PlanTask get_return_object()
+        {
+            return PlanTask(coroutine_handle<promise_type>::from_promise(*this));
+        }
+        
+        suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+        
+        suspend_always final_suspend() noexcept
+        {
+            return {};
+        }
+        
+        void return_void()
+        {
+        }
+        
+        void unhandled_exception()
+        {
+            terminate();
+        }
+    };
+    
+    coroutine_handle<promise_type> handle;
+    Pod* pod;
+    int priority;                       // lower first
+    
+    PlanTask(coroutine_handle<promise_type> h)
+    {
+        handle = h;
+        pod = nullptr;
+        priority = 0;
+    }
+    
+    PlanTask(PlanTask&& t) noexcept
+    {
+        handle = t.handle;
+        pod = t.pod;
+        priority = t.priority;
+        t.handle = nullptr;
+    }
+    
+    PlanTask& operator=(PlanTask&& t) noexcept
+    {
+        swap(handle, t.handle);
+        swap(pod, t.pod);
+        swap(priority, t.priority);
+        return *this;
+    }
+    
+    PlanTask(const PlanTask&) = delete;
+    
+    ~PlanTask()
+    {
+        if(handle)
+        {
+            handle.destroy();
+        }
+    }
+};
+
+PlanTask planPod(Pod* p)
+{
+    if(!p->startUpdate())
+    {
+        co_return;
+    }
+    co_await suspend_always{};
+    for(Mood* m : p->getContinent()->getMoodsByValue())
+    {
+        p->evaluate(m);
+        co_await suspend_always{};
+    }
+    p->finishUpdate();
+}
+
+class PlanScheduler {
+    public:
+        long long resumes;
+        int cut;                            // pods cut by the last cancel()
+        
+        PlanScheduler()
+        {
+            resumes = 0;
+            cut = 0;
+        }
+        
+        void add(Pod* p, int priority)
+        {
+            PlanTask task = planPod(p);
+            task.pod = p;
+            task.priority = priority;
+            _tasks.push_back(move(task));
+            push_heap(_tasks.begin(), _tasks.end(), isLater);
+        }
+        
+        //Resume tasks until all are done, false when the deadline came first
+        bool run(chrono::steady_clock::time_point deadline)
+        {
+            while(!_tasks.empty())
+            {
+                if(chrono::steady_clock::now() >= deadline)
+                {
+                    return false;
+                }
+                PlanTask& task = _tasks.front();
+                task.handle.resume();
+                task.handle.promise().started = true;
+                resumes++;
+                if(task.handle.done())
+                {
+                    logPod(task.pod);
+                    pop_heap(_tasks.begin(), _tasks.end(), isLater);
+                    _tasks.pop_back();
+                }
+            }
+            return true;
+        }
+        
+        //Pods cut among their moods move to their best intend, pods never started keep their course
+        void cancel()
+        {
+            cut = 0;
+            for(PlanTask& task : _tasks)
+            {
+                if(task.handle.promise().started)
+                {
+                    task.pod->finishUpdate();
+                }
+                else
+                {
+                    task.pod->keepCourse();
+                }
+                logPod(task.pod);
+                cut++;
+            }
+            _tasks.clear();
+        }
+    
+    private:
+        vector<PlanTask> _tasks;            // heap, next task first
+        
+        static bool isLater(const PlanTask& a, const PlanTask& b)
+        {
+            return a.priority > b.priority;
+        }
+};
+#endif
+
+/** PONDERING **/
+/*
+  Distances between every pair of zones, filled row by row.
+  Zones of a continent are contiguous, so each row only covers its own continent.
+  Rows are computed in the background and the work survives a cancellation.
+  Only built for boards small enough to be captured.
+*/
+class DistanceTable {
+    public:
+        DistanceTable(int zoneCount)
+        {
+            _zoneCount = zoneCount;
+            _computedRows = 0;
+            _rowOffsets.assign(zoneCount, 0);
+            int size = 0;
+            for(int z = 0; z < zoneCount; z++)
+            {
+                _rowOffsets[z] = size;
+                size += continentSize(z);
+            }
+            _rows.assign(size, -1);
+            _table = _rows.data();
+        }
+        
+        //Use complete rows from a map file in place
+        void adopt(const short* rows)
+        {
+            _table = rows;
+            _computedRows = _zoneCount;
+            vector<short>().swap(_rows);
+        }
+        
+        //Rows of every zone, back to back
+        const short* getRows()
+        {
+            return _table;
+        }
+        
+        int getRowsSize()
+        {
+            return _zoneCount == 0 ? 0 : _rowOffsets[_zoneCount - 1] + continentSize(_zoneCount - 1);
+        }
+        
+        bool isReady()
+        {
+            return _zoneCount > 0 && _computedRows == _zoneCount;
+        }
+        
+        //Distance from 'from' to 'to', -1 if on another continent
+        int get(int from, int to)
+        {
+            int c = topology->continentOf[from];
+            if(c != topology->continentOf[to])
+            {
+                return -1;
+            }
+            return _table[_rowOffsets[from] + to - topology->continentOffsets[c]];
+        }
+        
+        //Breadth first search from each missing row, until done or cancelled
+        void compute(const atomic<bool>& cancel)
+        {
+            vector<int> queue;
+            while(_computedRows < _zoneCount && !cancel.load(memory_order_relaxed))
+            {
+                int first = topology->continentOffsets[topology->continentOf[_computedRows]];
+                short* row = &_rows[_rowOffsets[_computedRows]];
+                queue.clear();
+                queue.push_back(_computedRows);
+                row[_computedRows - first] = 0;
+                for(size_t i = 0; i < queue.size(); i++)
+                {
+                    int z = queue[i];
+                    for(int k = topology->offsets[z]; k < topology->offsets[z + 1]; k++)
+                    {
+                        int n = topology->neighbours[k];
+                        if(row[n - first] == -1)
+                        {
+                            row[n - first] = row[z - first] + 1;
+                            queue.push_back(n);
+                        }
+                    }
+                }
+                _computedRows++;
+            }
+        }
+    
+    private:
+        int _zoneCount;
+        int _computedRows;
+        vector<int> _rowOffsets;        // start of each zone's row, rows only cover the zone's continent
+        vector<short> _rows;
+        const short* _table;            // '_rows', or rows mapped from a map file
+        
+        int continentSize(int z)
+        {
+            int c = topology->continentOf[z];
+            return topology->continentOffsets[c + 1] - topology->continentOffsets[c];
+        }
+};
+
+/*
+  Pondering : while we wait for the next turn's input, a worker thread
+  - fills the distance table
+  - predicts the next board twice : our orders applied, then enemies either holding
+    or moving as the mobility model expects, fights and income resolved
+  - computes the influence map of each predicted board
+  When the input arrives the worker is cancelled. If the real board matches a
+  prediction, its influence map is used as is.
+  The transposition cache is not warmed : its keys cover this turn's intends and
+  last turn's dangers, which a predicted board cannot reproduce exactly.
+*/
+class Ponderer {
+    public:
+        long long predictions;
+        long long hits[PONDER_PREDICTIONS];
+        
+        Ponderer()
+        {
+            _ready = 0;
+            _cancel = false;
+            for(int p = 0; p < PONDER_PREDICTIONS; p++)
+            {
+                _predictedInfluence[p] = new InfluenceMap(zones.size());
+                hits[p] = 0;
+            }
+            predictions = 0;
+        }
+        
+        ~Ponderer()
+        {
+            stop();
+            for(int p = 0; p < PONDER_PREDICTIONS; p++)
+            {
+                delete _predictedInfluence[p];
+            }
+        }
+        
+        void start()
+        {
+            _ready = 0;
+            if(!Board::canCapture())
+            {
+                return;
+            }
+            Board& holding = _predicted[0];
+            holding = Board::capture();
+            for(const Move& m : moves)
+            {
+                holding.applyMove(0, m.podsCount, m.zoneOrigin->index, m.zoneDestination->index);
+            }
+            for(const Create& c : creates)
+            {
+                holding.applyCreate(0, c.podsCount, c.zoneDestination->index);
+            }
+            _predicted[1] = holding;
+            mobility->predictMoves(_predicted[1]);
+            _cancel = false;
+            _topology = topology;
+            _mobility = mobility;
+            _distances = distances;
+            _worker = thread(&Ponderer::run, this);
+        }
+        
+        void stop()
+        {
+            if(_worker.joinable())
+            {
+                _cancel = true;
+                _worker.join();
+            }
+        }
+        
+        //Swap in the pondered influence map of the prediction the board went as
+        bool reuseInfluence()
+        {
+            if(_ready == 0)
+            {
+                return false;
+            }
+            predictions++;
+            int ready = _ready;
+            _ready = 0;
+            Board current = Board::capture();
+            for(int p = 0; p < ready; p++)
+            {
+                if(_predicted[p].hasSamePositions(current))
+                {
+                    hits[p]++;
+                    swap(influence, _predictedInfluence[p]);
+                    return true;
+                }
+            }
+            return false;
+        }
+        
+        void report()
+        {
+            cerr << "Pondering : predictions " << hits[0] << "+" << hits[1] << "/" << predictions << " (holding+moving), distances " << (distances->isReady() ? "ready" : "pending") << endl;
+        }
+    
+    private:
+        thread _worker;
+        atomic<bool> _cancel;
+        Board _predicted[PONDER_PREDICTIONS];
+        int _ready;                         // predictions whose influence map is complete
+        InfluenceMap* _predictedInfluence[PONDER_PREDICTIONS];
+        BoardTopology* _topology;           // of the game, globals are per thread
+        MobilityModel* _mobility;           // read only while pondering, rates weight the influence
+        DistanceTable* _distances;
+        
+        void run()
+        {
+            topology = _topology;
+            mobility = _mobility;
+            for(int p = 0; p < PONDER_PREDICTIONS && !_cancel; p++)
+            {
+                _predicted[p].resolveFights();
+                _predicted[p].applyIncome();
+                _predictedInfluence[p]->compute(_predicted[p]);
+                if(!_cancel)
+                {
+                    _ready = p + 1;
+                }
+            }
+            _distances->compute(_cancel);
+        }
+};
+
+void startPondering()
+{
+    if(serverMode)
+    {
+        return;
+    }
+    ponderer->start();
+}
+
+void stopPondering()
+{
+    ponderer->stop();
+}
+
+/** ASSIGNMENT **/
+/*
+  Min cost flow, successive shortest paths with potentials.
+  Edges are stored by pair, edge i ^ 1 being the reverse of edge i.
+  Storage is kept between solves.
+*/
+struct FlowEdge {
+    int to;
+    int capacity;
+    int cost;
+};
+
+class FlowSolver {
+    public:
+        void reset(int nodeCount)
+        {
+            _edges.clear();
+            _graph.resize(nodeCount);
+            for(vector<int>& g : _graph)
+            {
+                g.clear();
+            }
+        }
+        
+        int addEdge(int from, int to, int capacity, int cost)
+        {
+            _graph[from].push_back(_edges.size());
+            _edges.push_back({to, capacity, cost});
+            _graph[to].push_back(_edges.size());
+            _edges.push_back({from, 0, -cost});
+            return _edges.size() - 2;
+        }
+        
+        //Flow sent through an edge
+        int getFlow(int edge)
+        {
+            return _edges[edge ^ 1].capacity;
+        }
+        
+        //Push flow from source to sink while the cheapest path has a negative cost
+        void solve(int source, int sink)
+        {
+            int n = _graph.size();
+            _potential.assign(n, 0);
+            
+            //Initial potentials : Bellman-Ford, negative costs but no cycle yet
+            _distance.assign(n, FLOW_INFINITY);
+            _distance[source] = 0;
+            for(int pass = 0; pass < n; pass++)
+            {
+                bool changed = false;
+                for(int u = 0; u < n; u++)
+                {
+                    if(_distance[u] == FLOW_INFINITY)
+                    {
+                        continue;
+                    }
+                    for(int e : _graph[u])
+                    {
+                        if(_edges[e].capacity > 0 && _distance[u] + _edges[e].cost < _distance[_edges[e].to])
+                        {
+                            _distance[_edges[e].to] = _distance[u] + _edges[e].cost;
+                            changed = true;
+                        }
+                    }
+                }
+                if(!changed)
+                {
+                    break;
+                }
+            }
+            for(int u = 0; u < n; u++)
+            {
+                _potential[u] = _distance[u] == FLOW_INFINITY ? 0 : _distance[u];
+            }
+            
+            while(true)
+            {
+                //Dijkstra on reduced costs
+                _distance.assign(n, FLOW_INFINITY);
+                _parent.assign(n, -1);
+                _distance[source] = 0;
+                vector<pair<int, int> >& heap = _heap;
+                heap.clear();
+                heap.push_back(make_pair(0, source));
+                while(!heap.empty())
+                {
+                    pop_heap(heap.begin(), heap.end(), greater<pair<int, int> >());
+                    pair<int, int> top = heap.back();
+                    heap.pop_back();
+                    int u = top.second;
+                    if(top.first > _distance[u])
+                    {
+                        continue;
+                    }
+                    for(int e : _graph[u])
+                    {
+                        const FlowEdge& edge = _edges[e];
+                        if(edge.capacity <= 0)
+                        {
+                            continue;
+                        }
+                        int reduced = _distance[u] + edge.cost + _potential[u] - _potential[edge.to];
+                        if(reduced < _distance[edge.to])
+                        {
+                            _distance[edge.to] = reduced;
+                            _parent[edge.to] = e;
+                            heap.push_back(make_pair(reduced, edge.to));
+                            push_heap(heap.begin(), heap.end(), greater<pair<int, int> >());
+                        }
+                    }
+                }
+                if(_distance[sink] == FLOW_INFINITY)
+                {
+                    break;
+                }
+                for(int u = 0; u < n; u++)
+                {
+                    if(_distance[u] != FLOW_INFINITY)
+                    {
+                        _potential[u] += _distance[u];
+                    }
+                }
+                //Real cost of the path, stop once it is not worth it
+                if(_potential[sink] - _potential[source] >= 0)
+                {
+                    break;
+                }
+                int pushed = FLOW_INFINITY;
+                for(int v = sink; v != source; v = _edges[_parent[v] ^ 1].to)
+                {
+                    pushed = min(pushed, _edges[_parent[v]].capacity);
+                }
+                for(int v = sink; v != source; v = _edges[_parent[v] ^ 1].to)
+                {
+                    _edges[_parent[v]].capacity -= pushed;
+                    _edges[_parent[v] ^ 1].capacity += pushed;
+                }
+            }
+        }
+    
+    private:
+        vector<FlowEdge> _edges;
+        vector<vector<int> > _graph;
+        vector<int> _potential;
+        vector<int> _distance;
+        vector<int> _parent;
+        vector<pair<int, int> > _heap;
+};
+
+/*
+  'count' pods of zone 'from' sent toward 'target', first step on 'hop'
+*/
+struct Assignment {
+    int from;
+    int target;
+    int hop;
+    int count;
+    int weight;
+    Mood* mood;
+};
+
+/*
+  Assign the free pods of each continent to the targets of its moods.
+  - sources : zones holding pods not handled by the planner
+  - targets : zones caught by an enabled mood, worth the best base value of these moods
+  - a pod sent from s to t is worth baseValue - distance, as a mood intend would be
+  - a pod staying on a zone fulfilling a mood condition is worth the condition value
+  - a target accepts the pods needed to get supremacy on it
+  Pods without a profitable target are left to their moods.
+  A continent whose state did not change since last turn replays its last assignment.
+*/
+class Assigner {
+    public:
+        Assigner()
+        {
+            _distance.assign(zones.size(), -1);
+            _lastHash.assign(continents.size(), 0);
+            _lastAssignments.resize(continents.size());
+        }
+        
+        void update(const vector<int>& freePods)
+        {
+            for(Continent* c : continents)
+            {
+                if(c->isIgnored())
+                {
+                    continue;
+                }
+                unsigned long long hash = ZOBRIST_SEED;
+                for(Zone* z : c->myZones)
+                {
+                    hash ^= mix64(z->stateKey + freePods[z->index]);
+                }
+                if(hash != _lastHash[c->id])
+                {
+                    _lastHash[c->id] = hash;
+                    solve(c, freePods);
+                }
+                apply(_lastAssignments[c->id]);
+            }
+        }
+    
+    private:
+        FlowSolver _solver;
+        vector<int> _distance;                          // distance to the current target, -1 if unreached
+        vector<int> _queue;
+        vector<unsigned long long> _lastHash;           // state hash of each continent when last solved
+        vector<vector<Assignment> > _lastAssignments;   // last assignment of each continent
+        
+        //Breadth first distances from 'target', bounded by ASSIGNMENT_MAX_DISTANCE
+        void computeDistances(Zone* target)
+        {
+            for(int z : _queue)
+            {
+                _distance[z] = -1;
+            }
+            _queue.clear();
+            if(distances->isReady())
+            {
+                for(Zone* z : target->continent->myZones)
+                {
+                    int d = distances->get(target->index, z->index);
+                    if(d <= ASSIGNMENT_MAX_DISTANCE)
+                    {
+                        _distance[z->index] = d;
+                        _queue.push_back(z->index);
+                    }
+                }
+                return;
+            }
+            _queue.push_back(target->index);
+            _distance[target->index] = 0;
+            for(size_t i = 0; i < _queue.size(); i++)
+            {
+                int z = _queue[i];
+                if(_distance[z] == ASSIGNMENT_MAX_DISTANCE)
+                {
+                    continue;
+                }
+                for(int k = topology->offsets[z]; k < topology->offsets[z + 1]; k++)
+                {
+                    int n = topology->neighbours[k];
+                    if(_distance[n] == -1)
+                    {
+                        _distance[n] = _distance[z] + 1;
+                        _queue.push_back(n);
+                    }
+                }
+            }
+        }
+        
+        //First neighbour of 'from' getting closer to the current target
+        int nextHop(int from)
+        {
+            for(int k = topology->offsets[from]; k < topology->offsets[from + 1]; k++)
+            {
+                int n = topology->neighbours[k];
+                if(_distance[n] == _distance[from] - 1)
+                {
+                    return n;
+                }
+            }
+            return from;
+        }
+        
+        void solve(Continent* c, const vector<int>& freePods)
+        {
+            vector<Assignment>& result = _lastAssignments[c->id];
+            result.clear();
+            
+            vector<Mood*> moods = c->getMoods();
+            
+            //Sources and targets
+            vector<Zone*> sources;
+            vector<Zone*> targets;
+            vector<Mood*> targetMoods;
+            for(Zone* z : c->myZones)
+            {
+                if(freePods[z->index] > 0)
+                {
+                    sources.push_back(z);
+                }
+                Mood* best = nullptr;
+                for(size_t i = 0; i < moods.size(); i++)
+                {
+                    if(!moods[i]->isDisabled() && moods[i]->catches(z) && (best == nullptr || moods[i]->getBaseValue() > best->getBaseValue()))
+                    {
+                        best = moods[i];
+                    }
+                }
+                if(best != nullptr)
+                {
+                    targets.push_back(z);
+                    targetMoods.push_back(best);
+                }
+            }
+            if(sources.empty())
+            {
+                return;
+            }
+            
+            //Nodes : 0 source, 1 sink, then sources, then targets
+            int sourceNode = 0;
+            int sinkNode = 1;
+            int firstSource = 2;
+            int firstTarget = firstSource + sources.size();
+            _solver.reset(firstTarget + targets.size());
+            for(size_t i = 0; i < sources.size(); i++)
+            {
+                _solver.addEdge(sourceNode, firstSource + i, freePods[sources[i]->index], 0);
+            }
+            
+            //Candidate edges, remembered with their distance field
+            vector<int> edgeIds;
+            vector<Assignment> candidates;
+            for(size_t j = 0; j < targets.size(); j++)
+            {
+                Zone* t = targets[j];
+                int need = max(1, t->getMaxEnemyPod() + t->podDanger - t->myPods - t->getIntend() + 1);
+                _solver.addEdge(firstTarget + j, sinkNode, need, 0);
+                computeDistances(t);
+                for(size_t i = 0; i < sources.size(); i++)
+                {
+                    int d = _distance[sources[i]->index];
+                    if(d <= 0)
+                    {
+                        continue;
+                    }
+                    int weight = targetMoods[j]->getBaseValue() - d;
+                    edgeIds.push_back(_solver.addEdge(firstSource + i, firstTarget + j, sources.size() + 1, -weight));
+                    candidates.push_back({sources[i]->index, t->index, nextHop(sources[i]->index), 0, weight, targetMoods[j]});
+                }
+            }
+            
+            //Staying put when a mood condition holds
+            for(size_t i = 0; i < sources.size(); i++)
+            {
+                Mood* best = nullptr;
+                int weight = MIN_WEIGHT_RATIO;
+                for(Mood* m : moods)
+                {
+                    if(m->getConditionWeight(sources[i]) > weight)
+                    {
+                        weight = m->getConditionWeight(sources[i]);
+                        best = m;
+                    }
+                }
+                if(best != nullptr)
+                {
+                    edgeIds.push_back(_solver.addEdge(firstSource + i, sinkNode, freePods[sources[i]->index], -weight));
+                    candidates.push_back({sources[i]->index, sources[i]->index, sources[i]->index, 0, weight, best});
+                }
+            }
+            
+            _solver.solve(sourceNode, sinkNode);
+            for(size_t e = 0; e < edgeIds.size(); e++)
+            {
+                int flow = _solver.getFlow(edgeIds[e]);
+                if(flow > 0)
+                {
+                    candidates[e].count = flow;
+                    result.push_back(candidates[e]);
+                }
+            }
+        }
+        
+        //Hand the assignment to the free pods
+        void apply(const vector<Assignment>& assignments)
+        {
+            for(const Assignment& a : assignments)
+            {
+                int left = a.count;
+                for(Pod* p : pods)
+                {
+                    if(left == 0)
+                    {
+                        break;
+                    }
+                    if(p->planned || p->currentZone->index != a.from)
+                    {
+                        continue;
+                    }
+                    left--;
+                    p->dropPlan();
+                    p->planned = true;
+                    p->will = a.weight;
+                    //Only reported, the pod has no path to follow next turn
+                    p->lastMood = a.mood;
+                    p->intend = zones[a.hop];
+                    if(a.hop != a.from)
+                    {
+                        p->move(zones[a.hop]);
+                    }
+                }
+            }
+        }
+};
+
+/** MAP FILE **/
+/*
+  Precompiled map, mapped in memory and used in place.
+  A MapHeader is followed by int arrays, by zone index :
+  - order : id of the zone at each index
+  - platinum : as compiled, the bot uses the values read from stdin
+  - offsets and neighbours : CSR adjacency, zoneCount + 1 and 2 * linkCount entries
+  - neighbourIds : the same neighbours as zone ids, the zones links point into it
+  - continentOf
+  - continentOffsets : continentCount + 1 entries
+  then by 'distanceCount' shorts, the rows of the distance table.
+  Integers are native endian : files are built and read on the same kind of machine.
+  PLATINUM_MAP_COMPILE=<file> writes the map read from stdin, PLATINUM_MAP=<file> loads it.
+  The header holds the checksum of the text of the map lines of stdin it was compiled from.
+  A loaded file is checked against it : the zone lines are still parsed for the platinum,
+  the link lines are only hashed. The arrays are bounds checked once, then used in place.
+*/
+struct MapHeader {
+    char magic[8];
+    unsigned long long checksum;        // Overmind::mapChecksum of the compiled map
+    int zoneCount;
+    int linkCount;
+    int continentCount;
+    int distanceCount;                  // 0 when the distance table is not included
+};
+
+class MapFile {
+    public:
+        unsigned long long checksum;
+        int zoneCount;
+        int linkCount;
+        int continentCount;
+        int distanceCount;
+        const int* order;
+        const int* platinum;
+        const int* offsets;
+        const int* neighbours;
+        const int* neighbourIds;
+        const int* continentOf;
+        const int* continentOffsets;
+        const short* distanceRows;
+        
+        ~MapFile()
+        {
+            munmap(_data, _size);
+        }
+        
+        //nullptr when the file can't be mapped or is not a valid map of these counts,
+        //the checksum is left to the caller once the map lines are read
+        static MapFile* load(const char* path, int zoneCount, int linkCount)
+        {
+            int fd = open(path, O_RDONLY);
+            if(fd < 0)
+            {
+                cerr << "Map file : can't open " << path << endl;
+                return nullptr;
+            }
+            struct stat status;
+            void* data = MAP_FAILED;
+            if(fstat(fd, &status) == 0 && status.st_size >= (off_t)sizeof(MapHeader))
+            {
+                data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            }
+            close(fd);
+            if(data == MAP_FAILED)
+            {
+                cerr << "Map file : can't map " << path << endl;
+                return nullptr;
+            }
+            const MapHeader* header = (const MapHeader*)data;
+            size_t expected = 0;
+            if(memcmp(header->magic, MAP_FILE_MAGIC, sizeof(MAP_FILE_MAGIC)) == 0
+                && header->zoneCount >= 0 && header->linkCount >= 0 && header->continentCount >= 0 && header->distanceCount >= 0)
+            {
+                expected = sizeof(MapHeader)
+                    + sizeof(int) * (4 * (size_t)header->zoneCount + 1 + 4 * (size_t)header->linkCount + header->continentCount + 1)
+                    + sizeof(short) * (size_t)header->distanceCount;
+            }
+            
+            MapFile* m = new MapFile();
+            m->_data = data;
+            m->_size = status.st_size;
+            m->checksum = header->checksum;
+            m->zoneCount = header->zoneCount;
+            m->linkCount = header->linkCount;
+            m->continentCount = header->continentCount;
+            m->distanceCount = header->distanceCount;
+            const int* next = (const int*)(header + 1);
+            m->order = next;
+            next += m->zoneCount;
+            m->platinum = next;
+            next += m->zoneCount;
+            m->offsets = next;
+            next += m->zoneCount + 1;
+            m->neighbours = next;
+            next += 2 * m->linkCount;
+            m->neighbourIds = next;
+            next += 2 * m->linkCount;
+            m->continentOf = next;
+            next += m->zoneCount;
+            m->continentOffsets = next;
+            next += m->continentCount + 1;
+            m->distanceRows = m->distanceCount > 0 ? (const short*)next : nullptr;
+            
+            if(expected != (size_t)status.st_size || m->zoneCount != zoneCount || m->linkCount != linkCount || !m->isValid())
+            {
+                cerr << "Map file : " << path << " does not match the map" << endl;
+                delete m;
+                return nullptr;
+            }
+            return m;
+        }
+        
+        //Write the current map, with the distance table when it can be completed
+        static bool write(const char* path)
+        {
+            FILE* f = fopen(path, "wb");
+            if(f == nullptr)
+            {
+                cerr << "Map file : can't write " << path << endl;
+                return false;
+            }
+            atomic<bool> cancel(false);
+            distances->compute(cancel);
+            
+            MapHeader header;
+            memcpy(header.magic, MAP_FILE_MAGIC, sizeof(MAP_FILE_MAGIC));
+            header.checksum = overmind->mapChecksum;
+            header.zoneCount = topology->zoneCount;
+            header.linkCount = topology->neighbours.size() / 2;
+            header.continentCount = continents.size();
+            header.distanceCount = distances->getRowsSize();
+            vector<int> order;
+            vector<int> neighbourIds;
+            for(Zone* z : zones)
+            {
+                order.push_back(z->id);
+                for(Zone* l : z->links())
+                {
+                    neighbourIds.push_back(l->id);
+                }
+            }
+            bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+            ok = ok && writeInts(f, order.data(), order.size());
+            ok = ok && writeInts(f, topology->platinum.data(), topology->platinum.size());
+            ok = ok && writeInts(f, topology->offsets.data(), topology->offsets.size());
+            ok = ok && writeInts(f, topology->neighbours.data(), topology->neighbours.size());
+            ok = ok && writeInts(f, neighbourIds.data(), neighbourIds.size());
+            ok = ok && writeInts(f, topology->continentOf.data(), topology->continentOf.size());
+            ok = ok && writeInts(f, topology->continentOffsets.data(), topology->continentOffsets.size());
+            ok = ok && fwrite(distances->getRows(), sizeof(short), header.distanceCount, f) == (size_t)header.distanceCount;
+            ok = fclose(f) == 0 && ok;
+            cerr << "Map file : " << (ok ? "wrote " : "failed to write ") << path << endl;
+            return ok;
+        }
+    
+    private:
+        void* _data;                        // the whole mapping, unmapped with the map file
+        size_t _size;
+        
+        //Every index of the arrays is in range, neighbour ids agree with the indices,
+        //and the continents hold consecutive zones
+        bool isValid()
+        {
+            vector<bool> seen(zoneCount, false);
+            for(int i = 0; i < zoneCount; i++)
+            {
+                if(order[i] < 0 || order[i] >= zoneCount || seen[order[i]])
+                {
+                    return false;
+                }
+                seen[order[i]] = true;
+            }
+            if(offsets[0] != 0 || offsets[zoneCount] != 2 * linkCount)
+            {
+                return false;
+            }
+            for(int i = 0; i < zoneCount; i++)
+            {
+                if(offsets[i] > offsets[i + 1] || offsets[i + 1] - offsets[i] > MAX_NEIGHBOURS)
+                {
+                    return false;
+                }
+            }
+            for(int k = 0; k < 2 * linkCount; k++)
+            {
+                if(neighbours[k] < 0 || neighbours[k] >= zoneCount || neighbourIds[k] != order[neighbours[k]])
+                {
+                    return false;
+                }
+            }
+            if(continentOffsets[0] != 0 || continentOffsets[continentCount] != zoneCount)
+            {
+                return false;
+            }
+            for(int c = 0; c < continentCount; c++)
+            {
+                if(continentOffsets[c] > continentOffsets[c + 1])
+                {
+                    return false;
+                }
+            }
+            for(int i = 0; i < zoneCount; i++)
+            {
+                int c = continentOf[i];
+                if(c < 0 || c >= continentCount || i < continentOffsets[c] || i >= continentOffsets[c + 1])
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        
+        static bool writeInts(FILE* f, const int* items, int count)
+        {
+            return fwrite(items, sizeof(int), count, f) == (size_t)count;
+        }
+};
+
+/** REPLAY **/
+/*
+  Recorded games, an indexed store of their turns and batch analytics over it.
+  PLATINUM_RECORD=<file> appends one chunk per turn : a ReplayTurn followed by the owner
+  of each zone (by referee id), in a single write so that server games can share the file.
+  PLATINUM_REPLAY_INDEX=<store> reads recording paths on stdin, one per line, and groups
+  their chunks by game : a ReplayHeader, a ReplayGame per game with its first turn,
+  the byte offsets of the turns (turnCount + 1 entries), then the chunks.
+  PLATINUM_ANALYTICS=<store> maps the store and scans its games on every core :
+  decision latency, mood choices, purchase efficiency and territory by turn, as one JSON line.
+  The bot itself is never run again. Integers are native endian, as in map files.
+*/
+struct ReplayTurn {
+    unsigned long long game;            // key of the game, shared by its turns
+    int turn;
+    int decisionMicros;                 // from the turn's input to its commands
+    int platinum;                       // available when the turn starts
+    int income;                         // produced by our zones
+    int podsCreated;
+    int podsMoved;
+    int zoneCount;                      // owners following the turn
+    int zonesOwned[MAX_PLAYERS];        // int as zoneCount, maps go past a short
+    short playerCount;
+    short myId;
+    short moods[MAX_MOODS];             // pods which chose each mood, by mood index
+};
+
+struct ReplayHeader {
+    char magic[8];
+    int gameCount;
+    int turnCount;
+    char moodNames[MAX_MOODS][16];
+};
+
+struct ReplayGame {
+    unsigned long long key;
+    int firstTurn;
+    int turnCount;
+};
+
+class Recorder {
+    public:
+        bool enabled;
+        
+        Recorder(const char* path)
+        {
+            enabled = path != nullptr && path[0] != 0;
+            _fd = enabled ? open(path, O_WRONLY | O_CREAT | O_APPEND, 0644) : -1;
+            enabled = _fd >= 0;
+            static atomic<unsigned long long> games(0);
+            _key = mix64(((unsigned long long)getpid() << 32) ^ chrono::steady_clock::now().time_since_epoch().count() ^ games++);
+            _turn = 0;
+            _platinum = 0;
+        }
+        
+        ~Recorder()
+        {
+            if(_fd >= 0)
+            {
+                close(_fd);
+            }
+        }
+        
+        void startTurn()
+        {
+            _start = chrono::steady_clock::now();
+            _platinum = overmind->platinum;
+        }
+        
+        //Turns read past the end of the input are not recorded
+        void record()
+        {
+            if(!enabled || gameInput->fail())
+            {
+                return;
+            }
+            ReplayTurn t;
+            memset(&t, 0, sizeof(t));
+            t.game = _key;
+            t.turn = _turn++;
+            t.decisionMicros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - _start).count();
+            t.platinum = _platinum;
+            t.playerCount = overmind->playerCount;
+            t.myId = overmind->myId;
+            t.zoneCount = zonesById.size();
+            for(const Create& c : creates)
+            {
+                t.podsCreated += c.podsCount;
+            }
+            for(const Move& m : moves)
+            {
+                t.podsMoved += m.podsCount;
+            }
+            for(Pod* p : pods)
+            {
+                if(p->lastMood != nullptr && p->intend != nullptr)
+                {
+                    t.moods[p->lastMood->getIndex()]++;
+                }
+            }
+            for(Zone* z : zonesById)
+            {
+                if(z->owner >= 0 && z->owner < MAX_PLAYERS)
+                {
+                    t.zonesOwned[(int)z->owner]++;
+                }
+                if(z->isMine())
+                {
+                    t.income += z->platinum;
+                }
+            }
+            string chunk((const char*)&t, sizeof(t));
+            for(Zone* z : zonesById)
+            {
+                chunk += (char)z->owner;
+            }
+            if(::write(_fd, chunk.data(), chunk.size()) != (ssize_t)chunk.size())
+            {
+                enabled = false;
+            }
+        }
+    
+    private:
+        int _fd;
+        unsigned long long _key;
+        int _turn;
+        int _platinum;
+        chrono::steady_clock::time_point _start;
+};
+
+class ReplayStore {
+    public:
+        const ReplayHeader* header;
+        const ReplayGame* games;
+        const long long* offsets;           // of each turn, from the start of the file
+        
+        //Group the chunks of the recordings listed on 'list' by game
+        static bool build(const char* path, istream& list)
+        {
+            vector<string> files;
+            unordered_map<unsigned long long, int> gameOf;
+            vector<vector<pair<int, size_t> > > chunks;     // file and position of each turn, by game
+            string name;
+            while(getline(list, name))
+            {
+                if(name.empty())
+                {
+                    continue;
+                }
+                files.push_back(readFile(name.c_str()));
+                const string& data = files.back();
+                size_t pos = 0;
+                while(pos + sizeof(ReplayTurn) <= data.size())
+                {
+                    const ReplayTurn* t = (const ReplayTurn*)(data.data() + pos);
+                    size_t size = sizeof(ReplayTurn) + t->zoneCount;
+                    if(t->zoneCount < 0 || pos + size > data.size())
+                    {
+                        break;                  // truncated by a crash
+                    }
+                    auto found = gameOf.insert({t->game, (int)chunks.size()});
+                    if(found.second)
+                    {
+                        chunks.push_back({});
+                    }
+                    chunks[found.first->second].push_back({(int)files.size() - 1, pos});
+                    pos += size;
+                }
+            }
+            
+            ReplayHeader h;
+            memset(&h, 0, sizeof(h));
+            memcpy(h.magic, REPLAY_FILE_MAGIC, sizeof(REPLAY_FILE_MAGIC));
+            h.gameCount = chunks.size();
+            Overmind names;
+            names.playerCount = 2;
+            vector<Mood*> moods = names.initMoods();
+            for(size_t i = 0; i < moods.size() && i < MAX_MOODS; i++)
+            {
+                strncpy(h.moodNames[i], moods[i]->getName().c_str(), sizeof(h.moodNames[i]) - 1);
+            }
+            for(Mood* m : moods)
+            {
+                delete m;
+            }
+            vector<ReplayGame> table;
+            for(const vector<pair<int, size_t> >& game : chunks)
+            {
+                const ReplayTurn* first = (const ReplayTurn*)(files[game[0].first].data() + game[0].second);
+                table.push_back({first->game, h.turnCount, (int)game.size()});
+                h.turnCount += game.size();
+            }
+            vector<long long> turnOffsets;
+            long long offset = sizeof(ReplayHeader) + sizeof(ReplayGame) * table.size() + sizeof(long long) * (h.turnCount + 1);
+            for(const vector<pair<int, size_t> >& game : chunks)
+            {
+                for(const pair<int, size_t>& c : game)
+                {
+                    turnOffsets.push_back(offset);
+                    offset += sizeof(ReplayTurn) + ((const ReplayTurn*)(files[c.first].data() + c.second))->zoneCount;
+                }
+            }
+            turnOffsets.push_back(offset);
+            
+            FILE* f = fopen(path, "wb");
+            if(f == nullptr)
+            {
+                cerr << "Replay : can't write " << path << endl;
+                return false;
+            }
+            bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+            ok = ok && fwrite(table.data(), sizeof(ReplayGame), table.size(), f) == table.size();
+            ok = ok && fwrite(turnOffsets.data(), sizeof(long long), turnOffsets.size(), f) == turnOffsets.size();
+            for(const vector<pair<int, size_t> >& game : chunks)
+            {
+                for(const pair<int, size_t>& c : game)
+                {
+                    const char* chunk = files[c.first].data() + c.second;
+                    size_t size = sizeof(ReplayTurn) + ((const ReplayTurn*)chunk)->zoneCount;
+                    ok = ok && fwrite(chunk, 1, size, f) == size;
+                }
+            }
+            ok = fclose(f) == 0 && ok;
+            cerr << "Replay : " << (ok ? "wrote " : "failed to write ") << path << ", " << h.gameCount << " games, " << h.turnCount << " turns" << endl;
+            return ok;
+        }
+        
+        //nullptr when the file can't be mapped or is not a store
+        static ReplayStore* load(const char* path)
+        {
+            int fd = open(path, O_RDONLY);
+            if(fd < 0)
+            {
+                cerr << "Replay : can't open " << path << endl;
+                return nullptr;
+            }
+            struct stat status;
+            void* data = MAP_FAILED;
+            if(fstat(fd, &status) == 0 && status.st_size >= (off_t)sizeof(ReplayHeader))
+            {
+                data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            }
+            close(fd);
+            if(data == MAP_FAILED)
+            {
+                cerr << "Replay : can't map " << path << endl;
+                return nullptr;
+            }
+            ReplayStore* s = new ReplayStore();
+            s->header = (const ReplayHeader*)data;
+            s->games = (const ReplayGame*)(s->header + 1);
+            s->offsets = (const long long*)(s->games + max(0, s->header->gameCount));
+            if(memcmp(s->header->magic, REPLAY_FILE_MAGIC, sizeof(REPLAY_FILE_MAGIC)) != 0 || !s->isValid(status.st_size))
+            {
+                cerr << "Replay : " << path << " is not a replay store" << endl;
+                munmap(data, status.st_size);
+                delete s;
+                return nullptr;
+            }
+            return s;
+        }
+        
+        const ReplayTurn* getTurn(int i) const
+        {
+            return (const ReplayTurn*)((const char*)header + offsets[i]);
+        }
+        
+        //Owners of the zones at turn 'i', by referee id
+        const signed char* getOwners(int i) const
+        {
+            return (const signed char*)(getTurn(i) + 1);
+        }
+    
+    private:
+        //Every game, offset and turn stays inside the file, so that the analytics can trust them
+        bool isValid(size_t size) const
+        {
+            if(header->gameCount < 0 || header->turnCount < 0)
+            {
+                return false;
+            }
+            size_t tables = sizeof(ReplayHeader) + sizeof(ReplayGame) * (size_t)header->gameCount + sizeof(long long) * ((size_t)header->turnCount + 1);
+            if(tables > size || offsets[0] != (long long)tables || offsets[header->turnCount] != (long long)size)
+            {
+                return false;
+            }
+            for(int g = 0; g < header->gameCount; g++)
+            {
+                if(games[g].firstTurn < 0 || games[g].turnCount < 0 || (long long)games[g].firstTurn + games[g].turnCount > header->turnCount)
+                {
+                    return false;
+                }
+            }
+            for(int i = 0; i < header->turnCount; i++)
+            {
+                if(offsets[i + 1] - offsets[i] < (long long)sizeof(ReplayTurn))
+                {
+                    return false;
+                }
+                const ReplayTurn* t = getTurn(i);
+                if(t->zoneCount < 0 || offsets[i + 1] - offsets[i] != (long long)sizeof(ReplayTurn) + t->zoneCount
+                    || t->myId < 0 || t->myId >= MAX_PLAYERS || t->decisionMicros < 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        
+        static string readFile(const char* path)
+        {
+            string data;
+            FILE* f = fopen(path, "rb");
+            if(f == nullptr)
+            {
+                cerr << "Replay : can't read " << path << endl;
+                return data;
+            }
+            char buffer[1 << 16];
+            size_t n;
+            while((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+            {
+                data.append(buffer, n);
+            }
+            fclose(f);
+            return data;
+        }
+};
+
+/*
+  Aggregates of a slice of the store, summed over the threads once done.
+  Latencies are bucketed by REPLAY_LATENCY_BUCKET_US, territory is our share of the zones in
+  per mille, summed by turn with the number of games which reached that turn.
+*/
+struct ReplayStats {
+    long long games;
+    long long turns;
+    vector<long long> latency;
+    int maxLatency;
+    long long moods[MAX_MOODS];
+    long long available;                // platinum when the turns start
+    long long spent;                    // on pods
+    long long income;
+    vector<long long> territory;
+    vector<long long> territoryGames;
+    
+    ReplayStats()
+    {
+        games = 0;
+        turns = 0;
+        latency.assign(REPLAY_LATENCY_BUCKETS, 0);
+        maxLatency = 0;
+        memset(moods, 0, sizeof(moods));
+        available = 0;
+        spent = 0;
+        income = 0;
+    }
+    
+    void addGame(const ReplayStore& store, const ReplayGame& g)
+    {
+        games++;
+        for(int i = 0; i < g.turnCount; i++)
+        {
+            const ReplayTurn* t = store.getTurn(g.firstTurn + i);
+            turns++;
+            latency[min(REPLAY_LATENCY_BUCKETS - 1, t->decisionMicros / REPLAY_LATENCY_BUCKET_US)]++;
+            maxLatency = max(maxLatency, t->decisionMicros);
+            for(int m = 0; m < MAX_MOODS; m++)
+            {
+                moods[m] += t->moods[m];
+            }
+            available += t->platinum;
+            spent += t->podsCreated * POD_PRICE;
+            income += t->income;
+            if((int)territory.size() <= i)
+            {
+                territory.resize(i + 1, 0);
+                territoryGames.resize(i + 1, 0);
+            }
+            territory[i] += t->zoneCount > 0 ? 1000 * t->zonesOwned[t->myId] / t->zoneCount : 0;
+            territoryGames[i]++;
+        }
+    }
+    
+    void add(const ReplayStats& s)
+    {
+        games += s.games;
+        turns += s.turns;
+        for(int i = 0; i < REPLAY_LATENCY_BUCKETS; i++)
+        {
+            latency[i] += s.latency[i];
+        }
+        maxLatency = max(maxLatency, s.maxLatency);
+        for(int m = 0; m < MAX_MOODS; m++)
+        {
+            moods[m] += s.moods[m];
+        }
+        available += s.available;
+        spent += s.spent;
+        income += s.income;
+        if(territory.size() < s.territory.size())
+        {
+            territory.resize(s.territory.size(), 0);
+            territoryGames.resize(s.territory.size(), 0);
+        }
+        for(size_t i = 0; i < s.territory.size(); i++)
+        {
+            territory[i] += s.territory[i];
+            territoryGames[i] += s.territoryGames[i];
+        }
+    }
+    
+    //Upper bound of the bucket holding the 'percent' percentile
+    int getLatency(int percent) const
+    {
+        long long rank = (turns * percent + 99) / 100;
+        long long seen = 0;
+        for(int i = 0; i < REPLAY_LATENCY_BUCKETS; i++)
+        {
+            seen += latency[i];
+            if(seen >= rank && seen > 0)
+            {
+                return min(maxLatency, (i + 1) * REPLAY_LATENCY_BUCKET_US);
+            }
+        }
+        return maxLatency;
+    }
+};
+
+//Scan the store on every core and print the aggregates
+bool runAnalytics(const char* path)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    ReplayStore* store = ReplayStore::load(path);
+    if(store == nullptr)
+    {
+        return false;
+    }
+    int threadCount = max(1, (int)thread::hardware_concurrency());
+    vector<ReplayStats> stats(threadCount);
+    atomic<int> nextGame(0);
+    auto worker = [&] (int t) {
+        for(int g = nextGame++; g < store->header->gameCount; g = nextGame++)
+        {
+            stats[t].addGame(*store, store->games[g]);
+        }
+    };
+    vector<thread> threads;
+    for(int t = 1; t < threadCount; t++)
+    {
+        threads.push_back(thread(worker, t));
+    }
+    worker(0);
+    for(thread& t : threads)
+    {
+        t.join();
+    }
+    ReplayStats& total = stats[0];
+    for(int t = 1; t < threadCount; t++)
+    {
+        total.add(stats[t]);
+    }
+    
+    stringstream line;
+    line << "{\"games\":" << total.games << ",\"turns\":" << total.turns;
+    line << ",\"latency_us\":{\"p50\":" << total.getLatency(50) << ",\"p95\":" << total.getLatency(95) << ",\"p99\":" << total.getLatency(99) << ",\"max\":" << total.maxLatency << "}";
+    line << ",\"moods\":{";
+    bool first = true;
+    for(int m = 0; m < MAX_MOODS; m++)
+    {
+        if(store->header->moodNames[m][0] != 0 || total.moods[m] > 0)
+        {
+            line << (first ? "" : ",") << "\"" << (store->header->moodNames[m][0] != 0 ? string(store->header->moodNames[m], strnlen(store->header->moodNames[m], 16)) : "mood" + to_string(m)) << "\":" << total.moods[m];
+            first = false;
+        }
+    }
+    line << "},\"purchase\":{\"available\":" << total.available << ",\"spent\":" << total.spent << ",\"income\":" << total.income;
+    line << ",\"efficiency\":" << (total.available > 0 ? (double)total.spent / total.available : 0) << "}";
+    line << ",\"territory\":[";
+    for(size_t i = 0; i < total.territory.size(); i++)
+    {
+        line << (i > 0 ? "," : "") << (double)total.territory[i] / total.territoryGames[i] / 1000;
+    }
+    line << "],\"seconds\":" << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "}";
+    cout << line.str() << endl;
+    return true;
+}
+
+/** INITIALIZATION **/
+// get the information given by the program at beginning
+void initOvermind()
+{
+    overmind = new Overmind();
+    cache = new TranspositionCache();
+    
+    *gameInput >> overmind->playerCount >> overmind->myId >> overmind->zoneCount >> overmind->linkCount; gameInput->ignore();
+    
+    //The map lines of stdin are always read, for the platinum of the zones and the checksum
+    //a map file is checked with : its link lines are then only hashed, not parsed
+    const char* mapPath = getenv("PLATINUM_MAP");
+    if(mapPath != nullptr)
+    {
+        mapFile = MapFile::load(mapPath, overmind->zoneCount, overmind->linkCount);
+    }
+    unsigned long long checksum = mix64(((unsigned long long)overmind->zoneCount << 32) ^ overmind->linkCount);
+    string line;
+    for (int i = 0; i < overmind->zoneCount; i++) {
+        Zone* z = new Zone(overmind->myId);
+        getline(*gameInput, line);
+        checksum = hashText(checksum, line);
+        char* end;
+        z->id = strtol(line.c_str(), &end, 10);
+        z->platinum = strtol(end, nullptr, 10);
+        z->index = i;
+        zonesById.push_back(z);
+        
+        //cerr << "zone created : " << z->id << ", " << z->platinum << endl;
+    }
+    string linkLines;                   // kept until the map file is checked
+    vector<int> ends;                   // both zones of each parsed link
+    for (int i = 0; i < overmind->linkCount; i++) {
+        getline(*gameInput, line);
+        checksum = hashText(checksum, line);
+        if(mapFile != nullptr)
+        {
+            linkLines += line;
+            linkLines += '\n';
+        }
+        else
+        {
+            parseLink(line, ends);
+        }
+    }
+    overmind->mapChecksum = checksum;
+    if(mapFile != nullptr && mapFile->checksum != checksum)
+    {
+        cerr << "Map file : " << mapPath << " was not compiled from this map" << endl;
+        delete mapFile;
+        mapFile = nullptr;
+        istringstream text(linkLines);
+        while(getline(text, line))
+        {
+            parseLink(line, ends);
+        }
+    }
+    
+    if(mapFile != nullptr)
+    {
+        zones.resize(overmind->zoneCount);
+        for(int i = 0; i < overmind->zoneCount; i++)
+        {
+            Zone* z = zonesById[mapFile->order[i]];
+            z->index = i;
+            zones[i] = z;
+            z->setLinks(mapFile->neighbourIds + mapFile->offsets[i], mapFile->offsets[i + 1] - mapFile->offsets[i]);
+        }
+        return;
+    }
+    
+    //Neighbour ids grouped by zone id, each zone keeping the order of its links
+    zones = zonesById;
+    vector<int> first(overmind->zoneCount + 1, 0);
+    for(int end : ends)
+    {
+        first[end + 1]++;
+    }
+    for(int id = 0; id < overmind->zoneCount; id++)
+    {
+        first[id + 1] += first[id];
+    }
+    vector<int>& neighbourIds = overmind->neighbourIds;
+    neighbourIds.resize(ends.size());
+    vector<int> next(first.begin(), first.end() - 1);
+    for(size_t k = 0; k < ends.size(); k += 2)
+    {
+        neighbourIds[next[ends[k]]++] = ends[k + 1];
+        neighbourIds[next[ends[k + 1]]++] = ends[k];
+    }
+    for(Zone* z : zones)
+    {
+        z->setLinks(neighbourIds.data() + first[z->id], first[z->id + 1] - first[z->id]);
+    }
+}
+
+//Append both zones of a link line
+void parseLink(const string& line, vector<int>& ends)
+{
+    char* end;
+    int zone1 = strtol(line.c_str(), &end, 10);
+    int zone2 = strtol(end, nullptr, 10);
+    ends.push_back(zone1);
+    ends.push_back(zone2);
+}
+
+//CONTINENTS
+//Root of a zone in the union-find forest, halving the path on the way
+int findRoot(vector<int>& parent, int z)
+{
+    while(parent[z] != z)
+    {
+        parent[z] = parent[parent[z]];
+        z = parent[z];
+    }
+    return z;
+}
+
+//Initialize continents, from the map file when there is one.
+void initContinents()
+{
+    if(mapFile != nullptr)
+    {
+        loadContinents();
+    }
+    else
+    {
+        mergeContinents();
+    }
+    
+    cerr << "Continents : " << endl;
+    for(Continent* c : continents)
+    {
+        cerr << "name : " << c->getName() << endl;
+        cerr << "    size     : " << c->getSize() << endl;
+        cerr << "    platinum : " << c->platinum << endl;
+        c->computeWealthConcentration();
+        cerr << "    wealConc : " << c->wealthConcentration << endl;
+        c->computeValue();
+        cerr << "   Value     : " << c->value << endl;
+        overmind->worldValue += c->value;
+        cerr << endl;
+    }
+    cerr << "----------------" << endl;
+    cerr << "World Value : " << overmind->worldValue << endl; 
+    cerr << endl;
+}
+
+//Linked zones are merged with a union-find, the root of a continent being its lowest zone id.
+//Zones are then renumbered so that each continent is a contiguous slice of 'zones',
+//continents keeping the order of their first zone.
+void mergeContinents()
+{
+    int zoneCount = zonesById.size();
+    vector<int> parent(zoneCount);
+    for(int i = 0; i < zoneCount; i++)
+    {
+        parent[i] = i;
+    }
+    for(Zone* z : zonesById)
+    {
+        for(Zone* l : z->links())
+        {
+            int a = findRoot(parent, z->id);
+            int b = findRoot(parent, l->id);
+            if(a != b)
+            {
+                parent[max(a, b)] = min(a, b);
+            }
+        }
+    }
+    
+    vector<int> continentOfRoot(zoneCount, -1);
+    for(Zone* z : zonesById)
+    {
+        int root = findRoot(parent, z->id);
+        if(continentOfRoot[root] == -1)
+        {
+            continentOfRoot[root] = continents.size();
+            Continent* c = new Continent(continents.size());
+            continents.push_back(c);
+            overmind->spawnOverlord(c);
+        }
+        Continent* c = continents[continentOfRoot[root]];
+        z->continent = c;
+        c->platinum += z->platinum;
+        c->myZones.count++;
+    }
+    
+    //Counting sort of the zones by continent
+    vector<int> filled(continents.size(), 0);
+    int first = 0;
+    for(Continent* c : continents)
+    {
+        c->myZones.first = first;
+        first += c->myZones.count;
+    }
+    for(Zone* z : zonesById)
+    {
+        Continent* c = z->continent;
+        z->index = c->myZones.first + filled[c->id]++;
+        zones[z->index] = z;
+    }
+}
+
+//Continent ranges of the map file, zones are already in place
+void loadContinents()
+{
+    for(int i = 0; i < mapFile->continentCount; i++)
+    {
+        Continent* c = new Continent(i);
+        c->myZones.first = mapFile->continentOffsets[i];
+        c->myZones.count = mapFile->continentOffsets[i + 1] - c->myZones.first;
+        continents.push_back(c);
+        overmind->spawnOverlord(c);
+    }
+    for(Zone* z : zones)
+    {
+        z->continent = continents[mapFile->continentOf[z->index]];
+        z->continent->platinum += z->platinum;
+    }
+}
+
+//CLUSTERS
+//Cut each continent in connected clusters of at most CLUSTER_SIZE zones, grown breadth first,
+//then link the clusters holding neighbour zones.
+void initClusters()
+{
+    vector<Zone*> queue;
+    for(Zone* seed : zones)
+    {
+        if(seed->cluster != nullptr)
+        {
+            continue;
+        }
+        Cluster* c = new Cluster(seed->continent->clusters.size());
+        seed->cluster = c;
+        queue.clear();
+        queue.push_back(seed);
+        for(size_t i = 0; i < queue.size(); i++)
+        {
+            c->addZone(queue[i]);
+            for(Zone* l : queue[i]->links())
+            {
+                if(l->cluster == nullptr && queue.size() < CLUSTER_SIZE)
+                {
+                    l->cluster = c;
+                    queue.push_back(l);
+                }
+            }
+        }
+        seed->continent->clusters.push_back(c);
+    }
+    for(Zone* z : zones)
+    {
+        for(Zone* l : z->links())
+        {
+            vector<Cluster*>& links = z->cluster->links;
+            if(l->cluster != z->cluster && find(links.begin(), links.end(), l->cluster) == links.end())
+            {
+                links.push_back(l->cluster);
+            }
+        }
+    }
+}
+
+//TOPOLOGY
+//Flatten zones and links for the board snapshots, the map file already holds all but the platinum.
+void initTopology()
+{
+    topology = new BoardTopology();
+    int zoneCount = zones.size();
+    topology->zoneCount = zoneCount;
+    if(mapFile != nullptr)
+    {
+        topology->offsets.assign(mapFile->offsets, zoneCount + 1);
+        topology->neighbours.assign(mapFile->neighbours, 2 * mapFile->linkCount);
+        vector<int>& platinum = topology->storage[2];
+        for(Zone* z : zones)
+        {
+            platinum.push_back(z->platinum);
+        }
+        topology->platinum.assign(platinum.data(), zoneCount);
+        topology->continentOf.assign(mapFile->continentOf, zoneCount);
+        topology->continentOffsets.assign(mapFile->continentOffsets, mapFile->continentCount + 1);
+        return;
+    }
+    
+    vector<int>& offsets = topology->storage[0];
+    vector<int>& neighbours = topology->storage[1];
+    vector<int>& platinum = topology->storage[2];
+    vector<int>& continentOf = topology->storage[3];
+    vector<int>& continentOffsets = topology->storage[4];
+    offsets.push_back(0);
+    for(Zone* z : zones)
+    {
+        for(Zone* l : z->links())
+        {
+            neighbours.push_back(l->index);
+        }
+        offsets.push_back(neighbours.size());
+        platinum.push_back(z->platinum);
+        continentOf.push_back(z->continent->id);
+    }
+    for(Continent* c : continents)
+    {
+        continentOffsets.push_back(c->myZones.first);
+    }
+    continentOffsets.push_back(zoneCount);
+    topology->offsets.assign(offsets.data(), offsets.size());
+    topology->neighbours.assign(neighbours.data(), neighbours.size());
+    topology->platinum.assign(platinum.data(), platinum.size());
+    topology->continentOf.assign(continentOf.data(), continentOf.size());
+    topology->continentOffsets.assign(continentOffsets.data(), continentOffsets.size());
+}
+
+//FOOTPRINT
+//Layout of a zone before its fields were narrowed, only used by the footprint report.
+//It is kept by hand, the former sizes it gives are estimates and are reported as such.
+struct UnpackedZone {
+    int id;
+    int index;
+    int platinum;
+    int owner;
+    int myPods;
+    vector<Zone*> links;
+    int p1;
+    int p2;
+    int p3;
+    Continent* continent;
+    Cluster* cluster;
+    int myId;
+    int value;
+    int podDanger;
+    bool changed;
+    Zone* ancestor;
+    int visited;
+    unsigned long long stateKey;
+    unsigned long long localHash;
+    int podIntend;
+};
+
+//Bytes per zone and per continent, with estimates of the former layouts
+void reportFootprint()
+{
+    size_t linksBytes = 0;
+    for(Zone* z : zones)
+    {
+        linksBytes += z->linkCount * sizeof(Zone*);
+    }
+    size_t before = sizeof(UnpackedZone) + linksBytes / max<size_t>(1, zones.size());
+    Zone* z = zones[0];
+    cerr << "Footprint : zone " << sizeof(Zone) << " bytes (former layout ~" << before << ", estimated from the UnpackedZone mirror)";
+    cerr << ", turn state " << (char*)&z->id - (char*)z << " bytes";
+    cerr << ", continent " << sizeof(Continent) << " bytes (former layout ~" << sizeof(Continent) + sizeof(string) << ", estimated with its name string)" << endl;
+}
+
+//INIT GAME
+//Read the map and build the per game subsystems, 'game' is the id of a server game
+void initGame(int game)
+{
+    telemetry = new Telemetry(getenv("PLATINUM_TELEMETRY"), game);
+    recorder = new Recorder(getenv("PLATINUM_RECORD"));
+    chrono::steady_clock::time_point startup = chrono::steady_clock::now();
+    initOvermind();
+    initContinents();
+    initClusters();
+    initTopology();
+    cerr << "Startup : " << chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - startup).count() << "us, map " << (mapFile != nullptr ? "mapped" : "parsed") << endl;
+    reportFootprint();
+    overmind->computeMapFingerprint();
+    assigner = new Assigner();
+    influence = new InfluenceMap(zones.size());
+    frontier = new FrontierField(zones.size());
+    router = new LandmarkRouter();
+    mobility = new MobilityModel(zones.size());
+    distances = new DistanceTable(Board::canCapture() ? zones.size() : 0);
+    if(mapFile != nullptr && mapFile->distanceCount == distances->getRowsSize() && mapFile->distanceCount > 0)
+    {
+        distances->adopt(mapFile->distanceRows);
+    }
+    if(getenv("PLATINUM_MAP_COMPILE") != nullptr)
+    {
+        MapFile::write(getenv("PLATINUM_MAP_COMPILE"));
+    }
+    ponderer = new Ponderer();
+}
+
+
+/** UPDATE **/
+//UPDATE COMMANDS
+void updateCommands()
+{
+    //Move commands
+    stringstream command;
+    
+    if(moves.size() > 0){
+        for (const auto& m : moves)
+        {
+            command << m.podsCount << " " << m.zoneOrigin->id << " " << m.zoneDestination->id << " ";
+        }
+    }
+    else{
+        command <<  "WAIT";
+    }
+
+    *gameOutput << command.str() << endl;
+    
+    //Create commands
+    command.str("");
+    
+    if(creates.size() > 0){
+        for (const auto& c : creates)
+        {
+            command << c.podsCount << " " << c.zoneDestination->id << " ";
+        }
+    }
+    else{
+        command << "WAIT";
+    }
+
+    *gameOutput << command.str() << endl;
+}
+
+//UPDATE PLATINUM
+void updatePlatinum()
+{
+    *gameInput >> overmind->platinum; gameInput->ignore();
+}
+
+//UPDATE ZONES
+void updateZones()
+{
+    vector<int> won;
+    vector<int> lost;
+    for (int i = 0; i < overmind->zoneCount; i++) {
+        Zone* z = zonesById[i];
+        int lastOwner = z->owner;
+        bool wasMine = z->isMine();
+        int p1 = z->p1;
+        int p2 = z->p2;
+        int p3 = z->p3;
+        int owner;
+
+        //In a worry of simplicity, pods are sorted.
+        switch(overmind->myId)
+        {
+            case(0):
+                *gameInput >> z->id >> owner >> z->myPods >> z->p1 >> z->p2 >> z->p3; gameInput->ignore();
+            break;
+            case(1):
+                *gameInput >> z->id >> owner >> z->p1 >> z->myPods >> z->p2 >> z->p3; gameInput->ignore();
+            break;
+            case (2):
+                *gameInput >> z->id >> owner >> z->p1 >> z->p2 >> z->myPods >> z->p3; gameInput->ignore();
+            break;
+            default:
+                *gameInput >> z->id >> owner >> z->p1 >> z->p2 >> z->p3 >> z->myPods; gameInput->ignore();
+            break;
+        }
+        z->owner = owner;
+        mobility->observe(z->index, 1, p1, z->p1);
+        mobility->observe(z->index, 2, p2, z->p2);
+        mobility->observe(z->index, 3, p3, z->p3);
+        if(wasMine != z->isMine())
+        {
+            (wasMine ? lost : won).push_back(z->index);
+        }
+        z->changed = lastOwner != z->owner || p1 != z->p1 || p2 != z->p2 || p3 != z->p3;
+        z->continent->p1 += z->p1;
+        z->continent->p2 += z->p2;
+        z->continent->p3 += z->p3;
+        z->continent->myPods += z->myPods;
+        z->clearIntend();
+        
+        overmind->setZoneValue(z);
+    }
+    matchPods();
+    frontier->update(won, lost);
+    //Rates learnt up to the last turn, the ones the ponderer used : a pondered map stays exact
+    mobility->predict();
+    if(!exactShortcuts || !ponderer->reuseInfluence())
+    {
+        influence->compute();
+    }
+    mobility->update();
+    for(Zone* z : zones)
+    {
+        int danger = influence->danger[z->index];
+        z->changed = z->changed || danger != z->podDanger;
+        z->podDanger = danger;
+        refreshZoneKey(z);
+    }
+}
+
+//MATCH PODS
+//Last turn's pods are expected on the zone they were sent to and are matched against the new counts.
+//Pods missing from a zone died, pods in excess were bought.
+void matchPods()
+{
+    stable_sort(pods.begin(), pods.end(), [] (Pod* a, Pod* b) { return a->destination->id < b->destination->id;});
+    vector<Pod*> matched;
+    size_t next = 0;
+    for(Zone* z : zonesById)
+    {
+        int count = 0;
+        while(next < pods.size() && pods[next]->destination == z)
+        {
+            Pod* p = pods[next++];
+            if(count < z->myPods)
+            {
+                p->arrive(z);
+                matched.push_back(p);
+                count++;
+            }
+            else
+            {
+                delete p;
+            }
+        }
+        for(; count < z->myPods; count++)
+        {
+            matched.push_back(new Pod(z));
+        }
+    }
+    pods.swap(matched);
+}
+
+//UPDATE OVERMIND
+void updateOvermind()
+{
+    overmind->update();
+}
+
+//ESTIMATE TURN WORK
+//Zone expansions expected this turn : a search per active mood from each occupied zone, and the frontier
+int estimateTurnWork()
+{
+    int work = 0;
+    for(Continent* c : continents)
+    {
+        if(c->isIgnored())
+        {
+            continue;
+        }
+        int occupied = 0;
+        int frontierSize = 0;
+        for(Zone* z : c->myZones)
+        {
+            occupied += z->hasFriendOnIt() || z->hasEnemyPodOnIt();
+            frontierSize += frontier->distance[z->index] == 1;
+        }
+        int activeMoods = 0;
+        for(Mood* m : c->getMoods())
+        {
+            activeMoods += c->hasTargets(m);
+        }
+        work += occupied * activeMoods + frontierSize;
+    }
+    return work;
+}
+
+//UPDATE PLANNER
+void updatePlanner()
+{
+    turnCounters.turnWork = estimateTurnWork();
+#ifdef PLATINUM_DIFFERENTIAL
+    //Rollouts are bound by time, two runs never agree
+    return;
+#endif
+    planContestedZones();
+}
+
+//UPDATE ASSIGNMENT
+void updateAssignment()
+{
+    vector<int> freePods(zones.size(), 0);
+    for(Pod* p : pods)
+    {
+        if(!p->planned)
+        {
+            freePods[p->currentZone->index]++;
+        }
+    }
+    assigner->update(freePods);
+}
+
+//UPDATE PODS
+void updatePods()
+{
+#ifdef __cpp_impl_coroutine
+    thread_local PlanScheduler scheduler;
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(PODS_TIME_BUDGET_MS);
+    for(size_t i = 0; i < pods.size(); i++)
+    {
+        scheduler.add(pods[i], i);
+    }
+    if(!scheduler.run(deadline))
+    {
+        scheduler.cancel();
+        cerr << "Pods : deadline reached, " << scheduler.cut << " pods cut" << endl;
+    }
+#else
+    //Without coroutines the deadline is only checked between pods
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(PODS_TIME_BUDGET_MS);
+    int cut = 0;
+    for(Pod* p : pods)
+    {
+        //clock_t start;
+        //start = clock();
+    
+        if(chrono::steady_clock::now() >= deadline)
+        {
+            p->keepCourse();
+            logPod(p);
+            cut++;
+            continue;
+        }
+        p->update();
+        logPod(p);
+        
+        /*int duration = ((clock() - start ) * 1000 )/ ((double)CLOCKS_PER_SEC);
+        if(duration > 10)
+        {
+            cerr << "- Debug Pod : " << p->currentZone->id << endl;
+            for(string s : p->debug){
+                cerr << s << endl;
+            }
+        }*/
+    }
+    if(cut > 0)
+    {
+        cerr << "Pods : deadline reached, " << cut << " pods cut" << endl;
+    }
+#endif
+}
+
+//LOG POD
+void logPod(Pod* p)
+{
+    if(!p->currentZone->continent->isIgnored() && p->lastMood != nullptr && p->intend != nullptr){
+        cerr << "pod : " << p->currentZone->id << ", choosen mood " << p->lastMood->getName() << ", go in " << p->intend->id << endl;;
+    }
+}
+
+//UPDATE TELEMETRY
+//One JSON line : phase timings, search work, orders, chosen moods and continents ownership
+void updateTelemetry()
+{
+    if(!telemetry->enabled)
+    {
+        return;
+    }
+    int movedPods = 0;
+    for(const Move& m : moves)
+    {
+        movedPods += m.podsCount;
+    }
+    int createdPods = 0;
+    for(const Create& c : creates)
+    {
+        createdPods += c.podsCount;
+    }
+    vector<pair<string, int> > moods;
+    for(Pod* p : pods)
+    {
+        if(p->lastMood == nullptr || p->intend == nullptr)
+        {
+            continue;
+        }
+        size_t i = 0;
+        while(i < moods.size() && moods[i].first != p->lastMood->getName())
+        {
+            i++;
+        }
+        if(i == moods.size())
+        {
+            moods.push_back({p->lastMood->getName(), 0});
+        }
+        moods[i].second++;
+    }
+    
+    const Counters& counters = getTurnCounters();
+    const Counters& game = getGameCounters();
+    stringstream line;
+    line << "{\"turn\":" << telemetry->turn << ",\"time_us\":";
+    telemetry->writePhases(line);
+    line << ",\"pods\":" << pods.size() << ",\"pods_evaluated\":" << counters.podsEvaluated;
+    line << ",\"bfs_calls\":" << counters.bfsCalls << ",\"bfs_expanded\":" << counters.bfsExpanded;
+    line << ",\"catcher_calls\":" << counters.getCatcherCalls();
+    line << ",\"game\":{\"bfs_calls\":" << game.bfsCalls << ",\"catcher_calls\":" << game.getCatcherCalls() << ",\"pooled_turns\":" << game.pooledTurns << "}";
+    line << ",\"scheduler\":{\"mode\":\"" << (counters.pooledTurns > 0 ? "pool" : "inline") << "\",\"work\":" << counters.turnWork;
+    line << ",\"threshold\":" << (workerPool != nullptr ? workerPool->threshold : -1) << "}";
+    float support = 0;
+    float pressure = 0;
+    for(Zone* z : zones)
+    {
+        if(z->isMine())
+        {
+            support += influence->getStrength(z->index, 0);
+            pressure += influence->getEnemyStrength(z->index);
+        }
+    }
+    line << ",\"influence\":{\"support\":" << support << ",\"pressure\":" << pressure << "}";
+    line << ",\"mobility_us\":{\"update\":" << mobility->updateMicros << ",\"predict\":" << mobility->queryMicros << "}";
+    line << ",\"allocations\":{\"pods\":" << counters.podAllocations << ",\"intends\":" << counters.intendAllocations;
+    line << ",\"moves\":" << counters.moveAllocations << ",\"creates\":" << counters.createAllocations << "}";
+    line << ",\"moves\":" << moves.size() << ",\"moved_pods\":" << movedPods;
+    line << ",\"creates\":" << creates.size() << ",\"created_pods\":" << createdPods;
+    line << ",\"spent\":" << createdPods * POD_PRICE << ",\"moods\":{";
+    for(size_t i = 0; i < moods.size(); i++)
+    {
+        line << (i > 0 ? "," : "") << "\"" << moods[i].first << "\":" << moods[i].second;
+    }
+    line << "},\"continents\":[";
+    for(Continent* c : continents)
+    {
+        int mine = 0;
+        int hostile = 0;
+        for(Zone* z : c->myZones)
+        {
+            mine += z->isMine();
+            hostile += z->isHostil();
+        }
+        line << (c->id > 0 ? "," : "") << "{\"id\":" << c->id << ",\"zones\":" << c->getSize() << ",\"mine\":" << mine << ",\"hostile\":" << hostile << "}";
+    }
+    line << "]}\n";
+    telemetry->write(line.str());
+}
+
+//UPDATE RECORD
+void updateRecord()
+{
+    recorder->record();
+}
+
+//PLAY TURN
+//Read one turn and answer it
+void playTurn()
+{
+    updatePlatinum();
+    turnCounters.clear();
+    telemetry->startTurn();
+    recorder->startTurn();
+    stopPondering();
+    telemetry->mark("ponder_stop");
+    updateZones();
+    telemetry->mark("zones");
+    updateOvermind();
+    telemetry->mark("overmind");
+    updatePlanner();
+    telemetry->mark("planner");
+    updateAssignment();
+    telemetry->mark("assignment");
+    updatePods();
+    telemetry->mark("pods");
+    updateCommands();
+    telemetry->mark("commands");
+}
+
+//COUNTERS
+//Read only views used by the reports and the telemetry lines.
+//In server mode the game counters add up every game played by the worker thread.
+const Counters& getTurnCounters()
+{
+    return turnCounters;
+}
+
+const Counters& getGameCounters()
+{
+    return gameCounters;
+}
+
+void reportCounters()
+{
+    const Counters& c = getTurnCounters();
+    const Counters& game = getGameCounters();
+    cerr << "Counters : bfs " << c.bfsCalls << " calls " << c.bfsExpanded << " zones, catchers " << c.getCatcherCalls();
+    cerr << ", pods evaluated " << c.podsEvaluated << ", purchase cells " << c.purchaseCells;
+    cerr << ", routes " << c.routeCalls << " calls " << c.routeExpanded << " zones";
+    cerr << ", work " << c.turnWork << (c.pooledTurns > 0 ? " pooled" : " inline");
+    cerr << ", allocations pods " << c.podAllocations << " intends " << c.intendAllocations << " moves " << c.moveAllocations << " creates " << c.createAllocations << endl;
+    cerr << "Counters game : bfs " << game.bfsCalls << " calls " << game.bfsExpanded << " zones, catchers " << game.getCatcherCalls();
+    cerr << ", pods evaluated " << game.podsEvaluated << ", routes " << game.routeCalls << " calls, pooled turns " << game.pooledTurns << endl;
+}
+
+/** CLEAR **/
+void clear()
+{
+    moves.clear();
+    creates.clear();
+    for(Continent* c : continents)
+    {
+        c->clearPods();
+        c->clearIntends();
+    }
+}
+
+/** SERVER **/
+/*
+  Server mode, PLATINUM_SERVER=<workers> (0 : one per core) : one process plays many games.
+  Input frames are a line "<game> <lines>" followed by 'lines' lines of the referee protocol,
+  the first frame of a game holding its map and its first turn. A frame of 0 lines ends the game.
+  Each turn is answered by a line "<game> 2" followed by the two command lines.
+  Games are spread over the workers by id, so the frames of a game are played in order.
+  Globals are per thread : a worker swaps the World of a game in before playing one of its
+  frames, and out after. Counters stay with the worker : its game counters add up all its games.
+  Logs are silenced, pondering is off and planner rollouts stay on the worker.
+*/
+struct World {
+    vector<Zone*> zones;
+    vector<Zone*> zonesById;
+    vector<Continent*> continents;
+    vector<Move> moves;
+    vector<Create> creates;
+    vector<Pod*> pods;
+    Overmind* overmind;
+    BoardTopology* topology;
+    TranspositionCache* cache;
+    Assigner* assigner;
+    InfluenceMap* influence;
+    MobilityModel* mobility;
+    FrontierField* frontier;
+    LandmarkRouter* router;
+    DistanceTable* distances;
+    Ponderer* ponderer;
+    Telemetry* telemetry;
+    Recorder* recorder;
+    MapFile* mapFile;
+    
+    World()
+    {
+        overmind = nullptr;
+        topology = nullptr;
+        cache = nullptr;
+        assigner = nullptr;
+        influence = nullptr;
+        mobility = nullptr;
+        frontier = nullptr;
+        router = nullptr;
+        distances = nullptr;
+        ponderer = nullptr;
+        telemetry = nullptr;
+        recorder = nullptr;
+        mapFile = nullptr;
+    }
+    
+    //Exchange with the globals of the calling thread
+    void swapGlobals()
+    {
+        zones.swap(::zones);
+        zonesById.swap(::zonesById);
+        continents.swap(::continents);
+        moves.swap(::moves);
+        creates.swap(::creates);
+        pods.swap(::pods);
+        swap(overmind, ::overmind);
+        swap(topology, ::topology);
+        swap(cache, ::cache);
+        swap(assigner, ::assigner);
+        swap(influence, ::influence);
+        swap(mobility, ::mobility);
+        swap(frontier, ::frontier);
+        swap(router, ::router);
+        swap(distances, ::distances);
+        swap(ponderer, ::ponderer);
+        swap(telemetry, ::telemetry);
+        swap(recorder, ::recorder);
+        swap(mapFile, ::mapFile);
+    }
+    
+    //Frees the zones, pods and subsystems of a finished game, the world must be swapped out
+    void release()
+    {
+        for(Zone* z : zonesById)
+        {
+            delete z;
+        }
+        for(Continent* c : continents)
+        {
+            delete c;                   // and its clusters
+        }
+        for(Pod* p : pods)
+        {
+            delete p;
+        }
+        delete overmind;                // overlords and their moods
+        delete topology;
+        delete cache;
+        delete assigner;
+        delete influence;
+        delete mobility;
+        delete frontier;
+        delete router;
+        delete distances;
+        delete ponderer;
+        delete telemetry;
+        delete recorder;
+        delete mapFile;
+    }
+};
+
+struct GameFrame {
+    int game;
+    string text;                        // referee lines, empty at the end of the game
+};
+
+class GameServer {
+    public:
+        GameServer(int workerCount)
+        {
+            if(workerCount <= 0)
+            {
+                workerCount = max(1, (int)thread::hardware_concurrency());
+            }
+            for(int i = 0; i < workerCount; i++)
+            {
+                _workers.push_back(new Worker());
+            }
+            _frames = 0;
+        }
+        
+        ~GameServer()
+        {
+            for(Worker* w : _workers)
+            {
+                delete w;
+            }
+        }
+        
+        //Dispatch the frames of stdin until its end, then wait for the workers
+        void run()
+        {
+            serverMode = true;
+            cerr.setstate(ios::badbit);
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for(Worker* w : _workers)
+            {
+                w->closed = false;
+                w->worker = thread(&GameServer::work, this, w);
+            }
+            
+            int games = 0;
+            string line;
+            while(getline(cin, line))
+            {
+                GameFrame frame;
+                int lineCount = 0;
+                if(sscanf(line.c_str(), "%d %d", &frame.game, &lineCount) != 2)
+                {
+                    continue;
+                }
+                for(int i = 0; i < lineCount && getline(cin, line); i++)
+                {
+                    frame.text += line;
+                    frame.text += '\n';
+                }
+                games += lineCount == 0;
+                Worker* w = _workers[(unsigned)frame.game % _workers.size()];
+                lock_guard<mutex> lock(w->lock);
+                w->frames.push_back(move(frame));
+                w->ready.notify_one();
+            }
+            
+            for(Worker* w : _workers)
+            {
+                {
+                    lock_guard<mutex> lock(w->lock);
+                    w->closed = true;
+                    w->ready.notify_one();
+                }
+                w->worker.join();
+            }
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            cerr.clear();
+            cerr << "Server : " << _workers.size() << " workers, " << games << " games, " << _frames << " turns, " << seconds << "s, " << games / max(seconds, 1e-9) << " games/s" << endl;
+        }
+    
+    private:
+        struct Worker {
+            mutex lock;
+            condition_variable ready;
+            deque<GameFrame> frames;
+            bool closed;
+            thread worker;
+            unordered_map<int, World*> worlds;
+        };
+        
+        vector<Worker*> _workers;
+        mutex _outputLock;
+        atomic<long long> _frames;
+        
+        void work(Worker* w)
+        {
+            unique_lock<mutex> lock(w->lock);
+            while(true)
+            {
+                w->ready.wait(lock, [w] { return !w->frames.empty() || w->closed; });
+                if(w->frames.empty())
+                {
+                    return;
+                }
+                GameFrame frame = move(w->frames.front());
+                w->frames.pop_front();
+                lock.unlock();
+                play(w, frame);
+                lock.lock();
+            }
+        }
+        
+        void play(Worker* w, const GameFrame& frame)
+        {
+            World*& world = w->worlds[frame.game];
+            if(frame.text.empty())
+            {
+                if(world != nullptr)
+                {
+                    world->release();
+                    delete world;
+                }
+                w->worlds.erase(frame.game);
+                return;
+            }
+            if(world == nullptr)
+            {
+                world = new World();
+            }
+            
+            istringstream input(frame.text);
+            ostringstream output;
+            output << frame.game << " 2\n";
+            gameInput = &input;
+            gameOutput = &output;
+            world->swapGlobals();
+            if(overmind == nullptr)
+            {
+                initGame(frame.game);
+            }
+            playTurn();
+            gameCounters.add(turnCounters);
+            updateTelemetry();
+            updateRecord();
+            clear();
+            world->swapGlobals();
+            gameInput = &cin;
+            gameOutput = &cout;
+            _frames++;
+            
+            lock_guard<mutex> lock(_outputLock);
+            cout << output.str();
+            cout.flush();
+        }
+};
+
+#ifdef PLATINUM_DIFFERENTIAL
+/** DIFFERENTIAL **/
+/*
+  Differential harness, built with -DPLATINUM_DIFFERENTIAL.
+  Before a turn is played, its input is played twice by forked copies of the bot :
+  the reference, with every exact shortcut off (caches, cluster and frontier pruning,
+  mood bounds, path reuse, pondered influence), and the optimised bot as shipped.
+  DIFFERENTIAL_SYNTHETIC mutated copies of the turn are checked the same way.
+  Commands are compared as sets. The first divergence is reported with the input of the
+  zones it involves, the summary gives the speedup of the optimised side.
+  The process ends at the end of the input, with a failure status on any divergence.
+  
+  The shortcuts-off reference shares the code of the optimised bot. The frozen bot of
+  before this series runs next to it when PLATINUM_BASELINE names its binary, built with
+    git show 8e82ef5:platinum.cpp > baseline.cpp
+    g++ -std=c++11 -O2 -include functional baseline.cpp -o baseline
+  It is fed the map and the recorded turns through pipes, as the referee would, and its
+  commands are compared with the optimised ones. The series changes decisions on purpose,
+  so these changes are reported apart, with their own speedup, and never fail the run.
+  Synthetic turns are not sent to it, they would break the game it follows.
+*/
+class Differential {
+    public:
+        Differential()
+        {
+            _input = cin.rdbuf();
+            _turn = 0;
+            _checks = 0;
+            _divergences = 0;
+            _firstDivergence = -1;
+            _referenceMicros = 0;
+            _optimisedMicros = 0;
+            _baselinePid = -1;
+            _baselineTurns = 0;
+            _baselineChanges = 0;
+            _firstBaselineChange = -1;
+            _baselineMicros = 0;
+            _baselineOptimisedMicros = 0;
+            
+            //The map is read here so the baseline gets it verbatim, then played from the buffer
+            istream in(_input);
+            string line;
+            int playerCount = 0;
+            int myId = 0;
+            int zoneCount = 0;
+            int linkCount = 0;
+            getline(in, line);
+            istringstream(line) >> playerCount >> myId >> zoneCount >> linkCount;
+            string mapText = line + "\n";
+            for(int i = 0; i < zoneCount + linkCount && getline(in, line); i++)
+            {
+                mapText += line + "\n";
+            }
+            _buffer.str(mapText);
+            cin.rdbuf(&_buffer);
+            if(getenv("PLATINUM_BASELINE") != nullptr)
+            {
+                startBaseline(getenv("PLATINUM_BASELINE"), mapText);
+            }
+        }
+        
+        //Read the next turn and check it, the turn is then played from the buffer
+        void check()
+        {
+            stopPondering();
+            istream in(_input);
+            string text;
+            string line;
+            for(int i = 0; i <= overmind->zoneCount; i++)
+            {
+                if(!getline(in, line))
+                {
+                    report();
+                    exit(_divergences > 0);
+                }
+                text += line + "\n";
+            }
+            Random random(_turn + 1);
+            long long optimisedMicros;
+            string optimised = compare(text, "recorded", optimisedMicros);
+            if(_baselinePid > 0)
+            {
+                compareBaseline(text, optimised, optimisedMicros);
+            }
+            for(int i = 0; i < DIFFERENTIAL_SYNTHETIC; i++)
+            {
+                compare(mutate(text, random), "synthetic " + to_string(i), optimisedMicros);
+            }
+            _buffer.str(text);
+            cin.rdbuf(&_buffer);
+            cin.clear();
+            _turn++;
+        }
+        
+        void report()
+        {
+            cerr << "Differential : " << _turn << " turns, " << _checks << " checks, " << _divergences << " divergences";
+            if(_firstDivergence != -1)
+            {
+                cerr << ", first at turn " << _firstDivergence;
+            }
+            cerr << ", reference " << _referenceMicros / 1000 << "ms, optimised " << _optimisedMicros / 1000 << "ms";
+            cerr << ", speedup " << (double)_referenceMicros / max(1LL, _optimisedMicros) << endl;
+            if(_baselineTurns > 0)
+            {
+                cerr << "Baseline : " << _baselineTurns << " turns, " << _baselineChanges << " with changed decisions";
+                if(_firstBaselineChange != -1)
+                {
+                    cerr << ", first at turn " << _firstBaselineChange;
+                }
+                cerr << ", baseline " << _baselineMicros / 1000 << "ms, optimised " << _baselineOptimisedMicros / 1000 << "ms";
+                cerr << ", speedup " << (double)_baselineMicros / max(1LL, _baselineOptimisedMicros) << endl;
+            }
+            stopBaseline();
+        }
+    
+    private:
+        streambuf* _input;                  // real input of the bot
+        stringbuf _buffer;                  // turn being played
+        int _turn;
+        int _checks;
+        int _divergences;
+        int _firstDivergence;
+        long long _referenceMicros;
+        long long _optimisedMicros;
+        pid_t _baselinePid;                 // frozen bot of before the series, -1 without one
+        int _toBaseline;
+        int _fromBaseline;
+        string _baselinePending;            // output read past the last turn's commands
+        int _baselineTurns;                 // turns it answered
+        int _baselineChanges;
+        int _firstBaselineChange;
+        long long _baselineMicros;          // from the turn sent to its commands read
+        long long _baselineOptimisedMicros;
+        
+        void startBaseline(const char* path, const string& mapText)
+        {
+            int toChild[2];
+            int fromChild[2];
+            if(pipe(toChild) != 0 || pipe(fromChild) != 0)
+            {
+                cerr << "Differential : pipe failed" << endl;
+                exit(2);
+            }
+            cout.flush();
+            cerr.flush();
+            pid_t pid = fork();
+            if(pid == 0)
+            {
+                dup2(toChild[0], 0);
+                dup2(fromChild[1], 1);
+                int null = open("/dev/null", O_WRONLY);
+                dup2(null, 2);
+                close(toChild[1]);
+                close(fromChild[0]);
+                execl(path, path, (char*)nullptr);
+                _exit(127);
+            }
+            close(toChild[0]);
+            close(fromChild[1]);
+            if(pid < 0)
+            {
+                cerr << "Differential : baseline " << path << " not started" << endl;
+                return;
+            }
+            signal(SIGPIPE, SIG_IGN);
+            _baselinePid = pid;
+            _toBaseline = toChild[1];
+            _fromBaseline = fromChild[0];
+            sendBaseline(mapText);
+        }
+        
+        void stopBaseline()
+        {
+            if(_baselinePid > 0)
+            {
+                kill(_baselinePid, SIGTERM);
+                waitpid(_baselinePid, nullptr, 0);
+                close(_toBaseline);
+                close(_fromBaseline);
+                _baselinePid = -1;
+            }
+        }
+        
+        bool sendBaseline(const string& text)
+        {
+            for(size_t sent = 0; sent < text.size();)
+            {
+                ssize_t n = write(_toBaseline, text.data() + sent, text.size() - sent);
+                if(n <= 0)
+                {
+                    return false;
+                }
+                sent += n;
+            }
+            return true;
+        }
+        
+        //The two command lines of a turn, empty if the baseline died or ran out of time
+        string readBaseline()
+        {
+            char chunk[4096];
+            chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(DIFFERENTIAL_BASELINE_TIMEOUT_MS);
+            for(size_t eol = 0;;)
+            {
+                size_t first = _baselinePending.find('\n');
+                eol = first == string::npos ? string::npos : _baselinePending.find('\n', first + 1);
+                if(eol != string::npos)
+                {
+                    string result = _baselinePending.substr(0, eol + 1);
+                    _baselinePending.erase(0, eol + 1);
+                    return result;
+                }
+                int left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+                pollfd ready = {_fromBaseline, POLLIN, 0};
+                if(left <= 0 || poll(&ready, 1, left) <= 0)
+                {
+                    return "";
+                }
+                ssize_t n = read(_fromBaseline, chunk, sizeof(chunk));
+                if(n <= 0)
+                {
+                    return "";
+                }
+                _baselinePending.append(chunk, n);
+            }
+        }
+        
+        void compareBaseline(const string& text, const string& optimised, long long optimisedMicros)
+        {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            string baseline = sendBaseline(text) ? readBaseline() : "";
+            if(baseline.empty())
+            {
+                cerr << "Differential : baseline stopped or out of time at turn " << _turn << ", left out from now on" << endl;
+                stopBaseline();
+                return;
+            }
+            _baselineTurns++;
+            _baselineMicros += chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+            _baselineOptimisedMicros += optimisedMicros;
+            if(commandSet(baseline) == commandSet(optimised))
+            {
+                return;
+            }
+            _baselineChanges++;
+            if(_firstBaselineChange == -1)
+            {
+                _firstBaselineChange = _turn;
+                cerr << "Baseline : first changed decision at turn " << _turn << endl;
+                cerr << "baseline :" << endl << baseline << "optimised :" << endl << optimised;
+            }
+        }
+        
+        //Same turn with the platinum stock and a few pods counts changed
+        string mutate(const string& text, Random& random)
+        {
+            vector<string> lines;
+            istringstream in(text);
+            string line;
+            while(getline(in, line))
+            {
+                lines.push_back(line);
+            }
+            lines[0] = to_string(max(0, atoi(lines[0].c_str()) + POD_PRICE * (random.range(5) - 2)));
+            for(int i = 0; i < DIFFERENTIAL_MUTATIONS; i++)
+            {
+                string& zone = lines[1 + random.range(overmind->zoneCount)];
+                istringstream fields(zone);
+                int id;
+                int owner;
+                int pods[MAX_PLAYERS];
+                fields >> id >> owner >> pods[0] >> pods[1] >> pods[2] >> pods[3];
+                int player = random.range(overmind->playerCount);
+                pods[player] = max(0, pods[player] + random.range(5) - 2);
+                zone = to_string(id) + " " + to_string(owner);
+                for(int p = 0; p < MAX_PLAYERS; p++)
+                {
+                    zone += " " + to_string(pods[p]);
+                }
+            }
+            string result;
+            for(const string& l : lines)
+            {
+                result += l + "\n";
+            }
+            return result;
+        }
+        
+        //Play 'text' in a forked copy, its commands are sent back through a pipe
+        string play(const string& text, bool shortcuts, long long& micros)
+        {
+            int fds[2];
+            if(pipe(fds) != 0)
+            {
+                cerr << "Differential : pipe failed" << endl;
+                exit(2);
+            }
+            cout.flush();
+            cerr.flush();
+            pid_t pid = fork();
+            if(pid == 0)
+            {
+                close(fds[0]);
+                exactShortcuts = shortcuts;
+                telemetry->enabled = false;
+                cerr.rdbuf(nullptr);
+                stringbuf input(text);
+                cin.rdbuf(&input);
+                stringstream output;
+                cout.rdbuf(output.rdbuf());
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                playTurn();
+                long long elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+                string result = to_string(elapsed) + "\n" + output.str();
+                for(size_t sent = 0; sent < result.size();)
+                {
+                    ssize_t n = write(fds[1], result.data() + sent, result.size() - sent);
+                    if(n <= 0)
+                    {
+                        break;
+                    }
+                    sent += n;
+                }
+                _exit(0);
+            }
+            close(fds[1]);
+            string result;
+            char chunk[4096];
+            ssize_t n;
+            while((n = read(fds[0], chunk, sizeof(chunk))) > 0)
+            {
+                result.append(chunk, n);
+            }
+            close(fds[0]);
+            waitpid(pid, nullptr, 0);
+            size_t eol = result.find('\n');
+            if(pid < 0 || eol == string::npos)
+            {
+                micros = 0;
+                return "crashed\n";
+            }
+            micros = atoll(result.substr(0, eol).c_str());
+            return result.substr(eol + 1);
+        }
+        
+        //Pods moved from zone to zone, creates are keyed with an origin of -1
+        map<pair<int, int>, int> commandSet(const string& output)
+        {
+            map<pair<int, int>, int> commands;
+            istringstream in(output);
+            string line;
+            for(int isCreate = 0; isCreate < 2 && getline(in, line); isCreate++)
+            {
+                istringstream fields(line);
+                int count;
+                int from = -1;
+                int to;
+                while(fields >> count && (isCreate || fields >> from) && fields >> to)
+                {
+                    commands[{from, to}] += count;
+                }
+            }
+            return commands;
+        }
+        
+        //Optimised commands of 'text'
+        string compare(const string& text, const string& name, long long& optimisedMicros)
+        {
+            long long referenceMicros;
+            string reference = play(text, false, referenceMicros);
+            string optimised = play(text, true, optimisedMicros);
+            _checks++;
+            _referenceMicros += referenceMicros;
+            _optimisedMicros += optimisedMicros;
+            map<pair<int, int>, int> expected = commandSet(reference);
+            map<pair<int, int>, int> actual = commandSet(optimised);
+            if(expected == actual && reference != "crashed\n" && optimised != "crashed\n")
+            {
+                return optimised;
+            }
+            _divergences++;
+            if(_firstDivergence != -1)
+            {
+                return optimised;
+            }
+            _firstDivergence = _turn;
+            cerr << "Differential : first divergence at turn " << _turn << " (" << name << ")" << endl;
+            cerr << "reference :" << endl << reference << "optimised :" << endl << optimised;
+            vector<int> involved;
+            for(int side = 0; side < 2; side++)
+            {
+                const map<pair<int, int>, int>& mine = side ? actual : expected;
+                const map<pair<int, int>, int>& other = side ? expected : actual;
+                for(const auto& c : mine)
+                {
+                    auto match = other.find(c.first);
+                    if(match == other.end() || match->second != c.second)
+                    {
+                        involved.push_back(c.first.first);
+                        involved.push_back(c.first.second);
+                    }
+                }
+            }
+            istringstream in(text);
+            string line;
+            getline(in, line);
+            cerr << "platinum " << line << endl;
+            while(getline(in, line))
+            {
+                if(find(involved.begin(), involved.end(), atoi(line.c_str())) != involved.end())
+                {
+                    cerr << "zone " << line << endl;
+                }
+            }
+            return optimised;
+        }
+};
+#endif
+
+//OPENING BOOK
+//Play a whole board from an opening : every player moves its pods at random, preferring the
+//zones it does not own, and buys pods on random zones it may buy on. Returns our income
+//minus the best opponent's, summed over OPENING_BOOK_DEPTH turns.
+int playOpening(Board b, const vector<int>& opening, int playerCount, Random& random)
+{
+    vector<int> buyable;
+    for(int s = 1; s < playerCount; s++)
+    {
+        buyable.clear();
+        for(int z = 0; z < b.zoneCount; z++)
+        {
+            if(b.owner[z] == -1 || b.owner[z] == s)
+            {
+                buyable.push_back(z);
+            }
+        }
+        while(!buyable.empty() && b.platinum[s] >= POD_PRICE)
+        {
+            b.applyCreate(s, 1, buyable[random.range(buyable.size())]);
+        }
+    }
+    for(int z = 0; z < b.zoneCount; z++)
+    {
+        b.applyCreate(0, opening[z], z);
+    }
+    b.resolveFights();
+    
+    int score = 0;
+    Board start = b;
+    for(int turn = 0; turn < OPENING_BOOK_DEPTH; turn++)
+    {
+        start = b;
+        for(int s = 0; s < playerCount; s++)
+        {
+            for(int z = 0; z < b.zoneCount; z++)
+            {
+                int first = topology->offsets[z];
+                int degree = topology->offsets[z + 1] - first;
+                for(int pod = start.pods[s][z]; pod > 0 && degree > 0; pod--)
+                {
+                    int to = topology->neighbours[first + random.range(degree)];
+                    if(start.owner[to] == s)
+                    {
+                        to = topology->neighbours[first + random.range(degree)];
+                    }
+                    b.applyMove(s, 1, z, to);
+                }
+            }
+        }
+        b.resolveFights();
+        b.applyIncome();
+        int best = 0;
+        for(int s = 1; s < playerCount; s++)
+        {
+            best = max(best, b.income(s));
+        }
+        score += b.income(0) - best;
+        for(int s = 0; s < playerCount; s++)
+        {
+            buyable.clear();
+            for(int z = 0; z < b.zoneCount; z++)
+            {
+                if(b.owner[z] == -1 || b.owner[z] == s)
+                {
+                    buyable.push_back(z);
+                }
+            }
+            while(!buyable.empty() && b.platinum[s] >= POD_PRICE)
+            {
+                b.applyCreate(s, 1, buyable[random.range(buyable.size())]);
+            }
+        }
+    }
+    return score;
+}
+
+//Candidate openings of the first turn, as pods bought on each zone index :
+//the purchases of the bot, pods stacked on the richest zones, and random draws weighted by platinum.
+//The same seeds are used for every candidate, the best average is printed as book lines.
+bool generateOpening(int rollouts)
+{
+    if(!Board::canCapture() || rollouts <= 0)
+    {
+        cerr << "Opening book : needs a board of at most " << MAX_BOARD_ZONES << " zones and some rollouts" << endl;
+        return false;
+    }
+    ostringstream commands;             // the bot's own commands are not part of the book
+    gameOutput = &commands;
+    playTurn();
+    gameOutput = &cout;
+    int budget = overmind->platinum / POD_PRICE;
+    vector<int> played(zones.size(), 0);
+    for(const Create& c : creates)
+    {
+        played[c.zoneDestination->index] += c.podsCount;
+        budget += c.podsCount;
+    }
+    Board start = Board::capture();
+    for(int s = 0; s < overmind->playerCount; s++)
+    {
+        start.platinum[s] = overmind->platinum + (budget - (overmind->platinum / POD_PRICE)) * POD_PRICE;
+    }
+    
+    vector<int> free;
+    for(Zone* z : zones)
+    {
+        if(!z->isHostil())
+        {
+            free.push_back(z->index);
+        }
+    }
+    stable_sort(free.begin(), free.end(), [] (int a, int b) { return zones[a]->platinum > zones[b]->platinum;});
+    vector<vector<int> > candidates;
+    candidates.push_back(played);
+    for(int stack = 1; stack <= PURCHASE_MAX_INTEND; stack++)
+    {
+        vector<int> opening(zones.size(), 0);
+        int left = budget;
+        for(size_t i = 0; i < free.size() && left > 0; i++)
+        {
+            opening[free[i]] = min(stack, left);
+            left -= opening[free[i]];
+        }
+        candidates.push_back(opening);
+    }
+    Random draw(overmind->mapFingerprint);
+    int weights = 0;
+    for(int z : free)
+    {
+        weights += zones[z]->platinum + 1;
+    }
+    for(int sample = 0; sample < OPENING_BOOK_SAMPLES && weights > 0; sample++)
+    {
+        vector<int> opening(zones.size(), 0);
+        for(int pod = 0, tries = 0; pod < budget && tries < 100 * budget; tries++)
+        {
+            int pick = draw.range(weights);
+            size_t i = 0;
+            while(pick >= zones[free[i]]->platinum + 1)
+            {
+                pick -= zones[free[i]]->platinum + 1;
+                i++;
+            }
+            if(opening[free[i]] < PURCHASE_MAX_INTEND)
+            {
+                opening[free[i]]++;
+                pod++;
+            }
+        }
+        candidates.push_back(opening);
+    }
+    
+    int best = 0;
+    vector<long long> scores(candidates.size(), 0);
+    for(size_t c = 0; c < candidates.size(); c++)
+    {
+        for(int r = 0; r < rollouts; r++)
+        {
+            Random random(r + 1);
+            scores[c] += playOpening(start, candidates[c], overmind->playerCount, random);
+        }
+        if(scores[c] > scores[best])
+        {
+            best = c;
+        }
+    }
+    cerr << "Opening book : " << candidates.size() << " openings, bot " << (double)scores[0] / rollouts << ", best " << (double)scores[best] / rollouts << endl;
+    for(Zone* z : zones)
+    {
+        if(candidates[best][z->index] > 0)
+        {
+            cout << "    {0x" << hex << overmind->mapFingerprint << dec << "ULL, " << z->id << ", " << candidates[best][z->index] << "}," << endl;
+        }
+    }
+    return true;
+}
+
+/** MAIN **/
+int main()
+{
+    ios::sync_with_stdio(false);        // cin reads ahead instead of going through stdio
+    if(getenv("PLATINUM_REPLAY_INDEX") != nullptr)
+    {
+        return ReplayStore::build(getenv("PLATINUM_REPLAY_INDEX"), cin) ? 0 : 1;
+    }
+    if(getenv("PLATINUM_ANALYTICS") != nullptr)
+    {
+        return runAnalytics(getenv("PLATINUM_ANALYTICS")) ? 0 : 1;
+    }
+    if(getenv("PLATINUM_OPENING_BOOK") != nullptr)
+    {
+        initGame();
+        return generateOpening(atoi(getenv("PLATINUM_OPENING_BOOK"))) ? 0 : 1;
+    }
+    if(getenv("PLATINUM_SERVER") != nullptr)
+    {
+        GameServer(atoi(getenv("PLATINUM_SERVER"))).run();
+        return 0;
+    }
+#ifdef PLATINUM_DIFFERENTIAL
+    differential = new Differential();
+#endif
+    initGame();
+    workerPool = new WorkerPool(PLANNER_THREADS > 0 ? PLANNER_THREADS : thread::hardware_concurrency());
+    workerPool->calibrate();
+    
+    // game loop
+    while (1) {
+        clock_t start;
+        start = clock();
+        
+#ifdef PLATINUM_DIFFERENTIAL
+        differential->check();
+#endif
+        //The referee closed the input, there is nothing more to play :
+        //the ponder thread is joined, it must not outlive the game
+        if((*gameInput >> ws).eof())
+        {
+            stopPondering();
+            break;
+        }
+        playTurn();
+        gameCounters.add(turnCounters);
+        updateTelemetry();
+        updateRecord();
+        
+        int duration = ((clock() - start ) * 1000 )/ ((double)CLOCKS_PER_SEC);
+        cerr << "Time Game Loop : " << duration  << "ms" << endl;
+        cache->report();
+        ponderer->report();
+        mobility->report();
+        reportCounters();
+        
+        //Orders are still needed to predict the next board
+        startPondering();
+        clear();
     }
+    delete workerPool;
 }
 
 